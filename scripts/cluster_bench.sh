@@ -0,0 +1,101 @@
+#!/bin/bash
+# Scaling benchmark of the cluster mode on one box: a main node and 0, 1, 2, ...
+# worker processes connected over a Unix socket search the same positions for
+# a fixed time. Reports the depth reached and the nodes searched per size.
+#
+# Usage: scripts/cluster_bench.sh <engine> [max workers] [movetime ms] [threads]
+
+ENGINE=$1
+MAX_WORKERS=${2:-4}
+MOVETIME=${3:-5000}
+THREADS=${4:-1}
+
+if [ ! -x "$ENGINE" ]; then
+  >&2 echo "Usage: $0 <engine> [max workers] [movetime ms] [threads]"
+  exit 1
+fi
+
+TMP=$(mktemp -d)
+SOCK="$TMP/cluster.sock"
+trap 'kill $(jobs -p) 2> /dev/null; rm -rf "$TMP"' EXIT
+
+POSITIONS=(
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10"
+  "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8"
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+)
+
+send() { echo "$1" >&"${MAIN[1]}"; }
+
+# Reads the main node until a line starting with $1, keeping the last one
+# that starts with $2 in $LAST
+read_until() {
+  LAST=""
+  while read -r -u "${MAIN[0]}" line; do
+    case "$line" in
+      "$2"*) LAST=$line ;;
+    esac
+    case "$line" in
+      "$1"*) return 0 ;;
+    esac
+  done
+  return 1
+}
+
+field() { echo "$1" | sed -n "s/.* $2 \([0-9-]*\).*/\1/p"; }
+
+printf "%-8s %-10s %-14s %-14s %-12s\n" workers avg_depth main_nodes remote_nodes total_nps
+
+for ((n = 0; n <= MAX_WORKERS; n = n ? 2 * n : 1)); do
+  coproc MAIN { "$ENGINE" 2> /dev/null; }
+
+  send "setoption name Threads value $THREADS"
+  send "setoption name Cluster Address value unix:$SOCK"
+  send "setoption name Cluster Role value main"
+  send "isready"
+  read_until "readyok" ""
+
+  # Each worker reads its commands from a fifo kept open until the round ends
+  fds=()
+  for ((i = 0; i < n; i++)); do
+    mkfifo "$TMP/w$i"
+    "$ENGINE" < "$TMP/w$i" > /dev/null 2>&1 &
+    exec {fd}> "$TMP/w$i"
+    fds+=("$fd")
+    echo "setoption name Threads value $THREADS" >&"$fd"
+    echo "setoption name Cluster Address value unix:$SOCK" >&"$fd"
+    echo "setoption name Cluster Role value worker" >&"$fd"
+  done
+  sleep 1
+
+  depth=0 nodes=0 remote=0
+  for fen in "${POSITIONS[@]}"; do
+    send "position fen $fen"
+    send "go movetime $MOVETIME"
+    if ! read_until "bestmove" "info depth" || [ -z "$LAST" ]; then
+      >&2 echo "No search result for $fen, the main node has stopped"
+      exit 1
+    fi
+    depth=$((depth + $(field "$LAST" depth)))
+    nodes=$((nodes + $(field "$LAST" nodes)))
+
+    send "cluster"
+    read_until "info string Cluster" ""
+    remote=$((remote + $(echo "$line" | sed -n "s/.*remote nodes \([0-9]*\).*/\1/p")))
+  done
+
+  count=${#POSITIONS[@]}
+  printf "%-8s %-10s %-14s %-14s %-12s\n" "$n" \
+    "$(awk "BEGIN { printf \"%.1f\", $depth / $count }")" "$nodes" "$remote" \
+    "$(( (nodes + remote) * 1000 / (MOVETIME * count) ))"
+
+  send "quit"
+  wait "$MAIN_PID" 2> /dev/null
+  for fd in "${fds[@]}"; do
+    echo "quit" >&"$fd"
+    exec {fd}>&-
+  done
+  wait
+  rm -f "$TMP"/w*
+done
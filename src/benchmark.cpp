@@ -454,7 +454,7 @@ BenchmarkSetup setup_benchmark(std::istream& is) {
     int desiredTimeS;
 
     if (!(is >> setup.threads))
-        setup.threads = get_hardware_concurrency();
+        setup.threads = get_available_concurrency();
     else
         setup.originalInvocation += std::to_string(setup.threads);
 
@@ -0,0 +1,587 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cluster.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace Hypnos::Distributed {
+
+namespace {
+
+// A frame is a type byte and a 32 bit payload size, followed by the payload.
+// Everything is sent in the byte order of the host, all nodes being expected
+// to run the same binary.
+enum FrameType : uint8_t {
+    FrameGo,       // u32 search id, then "fen <fen> moves <m1> ..."
+    FrameStop,     // u32 search id
+    FrameEntries,  // Entry[]
+    FrameRoot      // RootResult
+};
+
+constexpr size_t HeaderSize      = 5;
+constexpr size_t MaxOutbox       = 1 << 16;  // Pending entries, further ones are dropped
+constexpr size_t MaxPeerBacklog  = 8 << 20;  // Unsent bytes before entries are dropped
+constexpr size_t EntriesPerFrame = 4096;
+constexpr size_t MaxGoPayload    = 1 << 20;  // Search id, FEN and the moves of a long game
+
+std::string frame(uint8_t type, const void* data, size_t size) {
+    std::string f(HeaderSize + size, '\0');
+    const auto  len = uint32_t(size);
+
+    f[0] = char(type);
+    std::memcpy(&f[1], &len, sizeof(len));
+    if (size)
+        std::memcpy(&f[HeaderSize], data, size);
+
+    return f;
+}
+
+std::string role_name(Role role) {
+    return role == Role::Main ? "main" : role == Role::Worker ? "worker" : "off";
+}
+
+}  // namespace
+
+#if defined(_WIN32)
+
+std::string Node::configure(Role role, const std::string&) {
+    return role == Role::Off ? "Cluster mode off" : "Cluster mode is not supported on Windows";
+}
+
+void Node::stop() {}
+void Node::run() {}
+
+#else
+
+namespace {
+
+void set_nonblocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+// Whether a received header announces a well-formed frame. A peer sending
+// anything else is disconnected before its payload is buffered.
+bool valid_frame(uint8_t type, size_t size) {
+    switch (type)
+    {
+    case FrameGo :
+        return size >= sizeof(uint32_t) && size <= MaxGoPayload;
+    case FrameStop :
+        return size == sizeof(uint32_t);
+    case FrameEntries :
+        return size % sizeof(Entry) == 0 && size <= EntriesPerFrame * sizeof(Entry);
+    case FrameRoot :
+        return size == sizeof(RootResult);
+    default :
+        return false;
+    }
+}
+
+// Splits "[host]:<port>", the host defaulting to the local host. A main node
+// listens on other interfaces only when given one, e.g. "0.0.0.0:<port>" or
+// "[::]:<port>" for all of them.
+bool parse_tcp(const std::string& address, std::string& host, std::string& port) {
+    const auto colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.size())
+        return false;
+
+    host = address.substr(0, colon);
+    port = address.substr(colon + 1);
+
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+
+    if (host.empty())
+        host = "127.0.0.1";
+
+    return true;
+}
+
+}  // namespace
+
+bool Node::open_socket(const std::string& address, std::string& error) {
+    const bool listen = currentRole == Role::Main;
+    int        fd     = -1;
+
+    if (address.rfind("unix:", 0) == 0)
+    {
+        const std::string path = address.substr(5);
+        sockaddr_un       sa{};
+
+        if (path.empty() || path.size() >= sizeof(sa.sun_path))
+        {
+            error = "Invalid socket path " + path;
+            return false;
+        }
+
+        sa.sun_family = AF_UNIX;
+        std::strcpy(sa.sun_path, path.c_str());
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listen)
+            unlink(path.c_str());  // Left over by a previous main node
+
+        if (fd < 0
+            || (listen ? bind(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0
+                           || ::listen(fd, 64) != 0
+                       : connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) != 0))
+        {
+            error = std::string("Cannot ") + (listen ? "listen on " : "connect to ") + address
+                  + ": " + std::strerror(errno);
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+    }
+    else
+    {
+        std::string host, port;
+        if (!parse_tcp(address, host, port))
+        {
+            error = "Invalid cluster address " + address + ", expected unix:<path> or [host]:<port>";
+            return false;
+        }
+
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = listen ? AI_PASSIVE : 0;
+
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0)
+        {
+            error = "Cannot resolve " + address;
+            return false;
+        }
+
+        for (addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next)
+        {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+
+            const int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            if (listen ? bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || ::listen(fd, 64) != 0
+                       : connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+
+        freeaddrinfo(res);
+
+        if (fd < 0)
+        {
+            error = std::string("Cannot ") + (listen ? "listen on " : "connect to ") + address
+                  + ": " + std::strerror(errno);
+            return false;
+        }
+
+        if (!listen)
+        {
+            const int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+    }
+
+    set_nonblocking(fd);
+
+    if (listen)
+        listenFd = fd;
+    else
+        peers.push_back({fd, {}, {}, {}});
+
+    return true;
+}
+
+std::string Node::configure(Role role, const std::string& address) {
+    stop();
+
+    if (role == Role::Off)
+        return "Cluster mode off";
+
+    currentRole    = role;
+    currentAddress = address;
+
+    std::string error;
+    if (pipe(wakeFd) != 0 || !open_socket(address, error))
+    {
+        if (error.empty())
+            error = "Cannot create the wake pipe";
+        stop();
+        return error;
+    }
+
+    set_nonblocking(wakeFd[0]);
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        peerCount = peers.size();
+    }
+
+    exit      = false;
+    isSharing = role == Role::Worker;
+    ioThread  = std::thread(&Node::run, this);
+
+    return "Cluster " + role_name(role) + (role == Role::Main ? " listening on " : " connected to ")
+         + address;
+}
+
+void Node::stop() {
+    if (ioThread.joinable())
+    {
+        exit = true;
+        if (write(wakeFd[1], "x", 1) < 0) {}
+        ioThread.join();
+    }
+
+    for (auto& peer : peers)
+        close(peer.fd);
+
+    for (int* fd : {&listenFd, &wakeFd[0], &wakeFd[1]})
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+
+    if (currentRole == Role::Main && currentAddress.rfind("unix:", 0) == 0)
+        unlink(currentAddress.substr(5).c_str());
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    peers.clear();
+    outbox.clear();
+    frames.clear();
+    searchCommand.clear();
+    peerCount   = 0;
+    isSharing   = false;
+    currentRole = Role::Off;
+}
+
+// Network thread: accepts the peers, moves the queued frames and the shared
+// entries to their send buffers and dispatches the received frames.
+void Node::run() {
+    std::vector<pollfd> fds;
+
+    while (!exit)
+    {
+        fds.clear();
+        fds.push_back({wakeFd[0], POLLIN, 0});
+        if (listenFd >= 0)
+            fds.push_back({listenFd, POLLIN, 0});
+        for (auto& peer : peers)
+            fds.push_back({peer.fd, short(POLLIN | (peer.out.empty() ? 0 : POLLOUT)), 0});
+
+        // Wakes up regularly to batch the entries shared meanwhile
+        poll(fds.data(), fds.size(), 20);
+
+        char drain[64];
+        while (read(wakeFd[0], drain, sizeof(drain)) > 0)
+        {}
+
+        if (listenFd >= 0 && (fds[1].revents & POLLIN))
+            for (int fd; (fd = accept(listenFd, nullptr, nullptr)) >= 0;)
+            {
+                set_nonblocking(fd);
+                peers.push_back({fd, {}, {}, {}});
+
+                // A late worker joins the running search
+                std::lock_guard<std::mutex> lk(mutex);
+                peers.back().out = searchCommand;
+            }
+
+        // Queued frames and entries, to every peer
+        std::vector<std::string> pending;
+        std::vector<Entry>       entries;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            pending.swap(frames);
+            entries.swap(outbox);
+            sentEntries += entries.size() * peers.size();
+        }
+
+        for (size_t i = 0; i < entries.size(); i += EntriesPerFrame)
+            pending.push_back(frame(FrameEntries, &entries[i],
+                                    std::min(EntriesPerFrame, entries.size() - i) * sizeof(Entry)));
+
+        for (auto& peer : peers)
+            for (const auto& f : pending)
+                if (f[0] != FrameEntries || peer.out.size() < MaxPeerBacklog)
+                    peer.out += f;
+
+        for (auto& peer : peers)
+        {
+            bool alive = read_frames(peer);
+
+            while (alive && !peer.out.empty())
+            {
+                const ssize_t n = send(peer.fd, peer.out.data(), peer.out.size(), MSG_NOSIGNAL);
+                if (n > 0)
+                    peer.out.erase(0, size_t(n));
+                else
+                {
+                    alive = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                    break;
+                }
+            }
+
+            if (!alive)
+            {
+                close(peer.fd);
+                peer.fd = -1;
+            }
+        }
+
+        peers.erase(std::remove_if(peers.begin(), peers.end(), [](const Peer& p) { return p.fd < 0; }),
+                    peers.end());
+
+        std::lock_guard<std::mutex> lk(mutex);
+        peerCount = peers.size();
+        isSharing = !peers.empty();
+    }
+}
+
+// Frames are dispatched after each read, so that the input buffer never holds
+// more than one incomplete frame and a chunk. Returns false when the peer has
+// closed the connection or sent an invalid frame.
+bool Node::read_frames(Peer& peer) {
+    char buf[1 << 16];
+
+    while (true)
+    {
+        const ssize_t n = recv(peer.fd, buf, sizeof(buf), 0);
+
+        if (n > 0)
+            peer.in.append(buf, size_t(n));
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            return false;  // Closed by the peer
+
+        size_t pos = 0;
+        while (peer.in.size() - pos >= HeaderSize)
+        {
+            const auto type = uint8_t(peer.in[pos]);
+            uint32_t   len;
+            std::memcpy(&len, &peer.in[pos + 1], sizeof(len));
+
+            if (!valid_frame(type, len))
+                return false;
+
+            if (peer.in.size() - pos < HeaderSize + len)
+                break;
+
+            handle_frame(peer, type, peer.in.substr(pos + HeaderSize, len));
+            pos += HeaderSize + len;
+        }
+
+        peer.in.erase(0, pos);
+    }
+
+    return true;
+}
+
+void Node::handle_frame(Peer& peer, uint8_t type, const std::string& payload) {
+    uint32_t id = 0;
+    if ((type == FrameGo || type == FrameStop) && payload.size() >= sizeof(id))
+        std::memcpy(&id, payload.data(), sizeof(id));
+
+    switch (type)
+    {
+    case FrameGo : {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            searchId = id;
+        }
+
+        std::istringstream       is(payload.substr(sizeof(id)));
+        std::string              token, fen;
+        std::vector<std::string> moves;
+
+        is >> token;  // "fen"
+        while (is >> token && token != "moves")
+            fen += token + " ";
+        while (is >> token)
+            moves.push_back(token);
+
+        if (onGo)
+            onGo(fen, moves);
+        break;
+    }
+
+    case FrameStop :
+        if (onStop)
+            onStop();
+        break;
+
+    case FrameEntries : {
+        const size_t n = payload.size() / sizeof(Entry);
+        Entry        e;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::memcpy(&e, payload.data() + i * sizeof(Entry), sizeof(Entry));
+            if (onEntry)
+                onEntry(e);
+        }
+
+        // The main node relays them to the other workers
+        size_t relayed = 0;
+        if (currentRole == Role::Main)
+            for (auto& other : peers)
+                if (&other != &peer && other.out.size() < MaxPeerBacklog)
+                {
+                    other.out += frame(FrameEntries, payload.data(), n * sizeof(Entry));
+                    relayed += n;
+                }
+
+        std::lock_guard<std::mutex> lk(mutex);
+        receivedEntries += n;
+        sentEntries += relayed;
+        break;
+    }
+
+    case FrameRoot : {
+        if (payload.size() != sizeof(RootResult))
+            break;
+
+        std::memcpy(&peer.root, payload.data(), sizeof(RootResult));
+
+        std::lock_guard<std::mutex> lk(mutex);
+
+        if (peer.root.searchId != searchId)
+            break;
+
+        if (peer.root.depth > bestRoot.depth)
+            bestRoot = peer.root;
+
+        remoteNodes = 0;
+        for (const auto& p : peers)
+            if (p.root.searchId == searchId)
+                remoteNodes += p.root.nodes;
+        break;
+    }
+
+    default :
+        break;
+    }
+}
+
+#endif
+
+void Node::queue_frame(uint8_t type, const void* data, size_t size) {
+    frames.push_back(frame(type, data, size));
+
+#if !defined(_WIN32)
+    if (write(wakeFd[1], "x", 1) < 0) {}
+#endif
+}
+
+void Node::start_search(const std::string& fen, const std::vector<std::string>& moves) {
+    if (currentRole != Role::Main)
+        return;
+
+    std::string payload(sizeof(uint32_t), '\0');
+    payload += "fen " + fen + " moves";
+    for (const auto& m : moves)
+        payload += " " + m;
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    ++searchId;
+    std::memcpy(&payload[0], &searchId, sizeof(searchId));
+
+    bestRoot      = RootResult{};
+    remoteNodes   = 0;
+    searchCommand = frame(FrameGo, payload.data(), payload.size());
+    queue_frame(FrameGo, payload.data(), payload.size());
+}
+
+void Node::stop_search() {
+    if (currentRole != Role::Main)
+        return;
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    if (searchCommand.empty())
+        return;
+
+    searchCommand.clear();
+    queue_frame(FrameStop, &searchId, sizeof(searchId));
+}
+
+void Node::share(Key key, Value v, bool pv, Bound b, Depth d, Move m, Value ev) {
+    const Entry e{key,         int16_t(v), int16_t(ev), m.raw(), int8_t(d),
+                  uint8_t(b | (pv << 2))};
+
+    std::lock_guard<std::mutex> lk(mutex);
+    if (outbox.size() < MaxOutbox)
+        outbox.push_back(e);
+}
+
+void Node::share_root(Depth depth, Value score, Move move, uint64_t nodes) {
+    if (currentRole != Role::Worker || !sharing())
+        return;
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    const RootResult r{searchId, depth, score, move.raw(), nodes};
+    queue_frame(FrameRoot, &r, sizeof(r));
+}
+
+RootResult Node::best_remote() const {
+    std::lock_guard<std::mutex> lk(mutex);
+    return currentRole == Role::Main ? bestRoot : RootResult{};
+}
+
+std::string Node::status() const {
+    std::lock_guard<std::mutex> lk(mutex);
+    std::ostringstream          ss;
+
+    if (currentRole == Role::Off)
+        return "Cluster mode off";
+
+    ss << "Cluster " << role_name(currentRole) << " on " << currentAddress << ": " << peerCount
+       << (peerCount == 1 ? " peer" : " peers") << ", entries sent " << sentEntries
+       << " received " << receivedEntries;
+
+    if (currentRole == Role::Main)
+        ss << ", search " << searchId << " remote depth " << bestRoot.depth << " remote nodes "
+           << remoteNodes;
+
+    return ss.str();
+}
+
+}  // namespace Hypnos::Distributed
@@ -0,0 +1,138 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CLUSTER_H_INCLUDED
+#define CLUSTER_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.h"
+
+namespace Hypnos::Distributed {
+
+// Cluster mode: several engine processes search the same position and gossip
+// their deep TT entries, Lazy SMP style. The main node accepts the workers on
+// a TCP or Unix socket, sends them each search and stops them with its own,
+// and relays the entries of every worker to the others. The workers report
+// their completed iterations, so that the main node can play the move of a
+// deeper one. Time management and "bestmove" are done by the main node only.
+
+enum class Role {
+    Off,
+    Main,
+    Worker
+};
+
+inline constexpr const char* RoleCombo = "off var off var main var worker";
+
+// TT writes of at least this depth are sent to the other nodes
+constexpr Depth ShareDepth = 8;
+
+// A TT entry on the wire, with the value as stored in the TT
+struct Entry {
+    Key      key;
+    int16_t  value, eval;
+    uint16_t move;
+    int8_t   depth;
+    uint8_t  boundPv;  // Bound in the low two bits, the PV flag above
+};
+
+static_assert(sizeof(Entry) == 16, "Entry is sent as raw bytes");
+
+// The last completed iteration of a peer for the current search
+struct RootResult {
+    uint32_t searchId;
+    int32_t  depth;
+    int32_t  score;
+    uint16_t move;
+    uint64_t nodes;
+};
+
+class Node {
+   public:
+    ~Node() { stop(); }
+
+    // Starts the node with the given role, or stops it with Role::Off.
+    // The address is "unix:<path>" or "[host]:<port>", the host defaulting
+    // to the local host. Returns a message for the GUI.
+    std::string configure(Role role, const std::string& address);
+
+    Role        role() const { return currentRole; }
+    std::string status() const;
+
+    // Main node, at the start and the end of each search
+    void start_search(const std::string& fen, const std::vector<std::string>& moves);
+    void stop_search();
+
+    // Any search thread, for its deep TT writes. Cheap when the node is idle.
+    bool sharing() const { return isSharing.load(std::memory_order_relaxed); }
+    void share(Key key, Value v, bool pv, Bound b, Depth d, Move m, Value ev);
+
+    // Main thread of a worker, after each completed iteration
+    void share_root(Depth depth, Value score, Move move, uint64_t nodes);
+
+    // Deepest peer iteration of the current search (depth 0 if none)
+    RootResult best_remote() const;
+
+    // Set by the engine, called from the network thread
+    std::function<void(const std::string& fen, const std::vector<std::string>& moves)> onGo;
+    std::function<void()>                                                            onStop;
+    std::function<void(const Entry&)>                                                onEntry;
+
+   private:
+    struct Peer {
+        int         fd;
+        std::string in, out;
+        RootResult  root;
+    };
+
+    void stop();
+    void run();
+    bool open_socket(const std::string& address, std::string& error);
+    void queue_frame(uint8_t type, const void* data, size_t size);
+    bool read_frames(Peer& peer);
+    void handle_frame(Peer& peer, uint8_t type, const std::string& payload);
+
+    Role              currentRole = Role::Off;
+    std::string       currentAddress;
+    std::thread       ioThread;
+    std::atomic_bool  exit{false}, isSharing{false};
+    int               listenFd = -1, wakeFd[2] = {-1, -1};
+    std::vector<Peer> peers;
+
+    // Filled by the search threads and the engine thread, drained by run()
+    mutable std::mutex       mutex;
+    std::vector<Entry>       outbox;
+    std::vector<std::string> frames;  // Complete frames for every peer
+    RootResult               bestRoot{};
+    uint32_t                 searchId = 0;
+    std::string              searchCommand;  // Go frame of the running search, for late peers
+    size_t                   peerCount   = 0;
+    uint64_t                 remoteNodes = 0, sentEntries = 0, receivedEntries = 0;
+};
+
+}  // namespace Hypnos::Distributed
+
+#endif  // #ifndef CLUSTER_H_INCLUDED
@@ -22,7 +22,10 @@
 #include <algorithm>  // std::max
 #include <optional>
 #include <cassert>
+#include <iomanip>
 #include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iosfwd>
 #include <memory>
 #include <ostream>
@@ -32,7 +35,9 @@
 #include <vector>
 
 #include "evaluate.h"
+#include "memory.h"
 #include "misc.h"
+#include "movegen.h"
 #include "nnue/network.h"
 #include "nnue/nnue_common.h"
 #include "nnue/nnue_misc.h"
@@ -42,6 +47,7 @@
 #include "position.h"
 #include "search.h"
 #include "shm.h"
+#include "snapshot.h"
 #include "syzygy/tbprobe.h"
 #include "types.h"
 #include "uci.h"
@@ -79,6 +85,29 @@ constexpr auto StartFEN   = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq
 constexpr int  MaxHashMB  = Is64Bit ? 33554432 : 2048;
 int            MaxThreads = std::max(1024, 4 * int(get_hardware_concurrency()));
 
+namespace {
+
+// The statistics a worker learns during search and keeps between searches
+std::vector<Snapshot::Block> history_blocks(Search::Worker& w) {
+    static_assert(std::is_trivially_copyable_v<ContinuationHistory>);
+
+    return {{&w.mainHistory, sizeof(w.mainHistory)},
+            {&w.captureHistory, sizeof(w.captureHistory)},
+            {&w.continuationHistory, sizeof(w.continuationHistory)},
+            {&w.pawnHistory, sizeof(w.pawnHistory)},
+            {&w.pawnCorrectionHistory, sizeof(w.pawnCorrectionHistory)},
+            {&w.minorPieceCorrectionHistory, sizeof(w.minorPieceCorrectionHistory)},
+            {&w.nonPawnCorrectionHistory, sizeof(w.nonPawnCorrectionHistory)},
+            {&w.continuationCorrectionHistory, sizeof(w.continuationCorrectionHistory)},
+            {&w.ttMoveHistory, sizeof(w.ttMoveHistory)}};
+}
+
+std::string snapshot_file(const std::filesystem::path& dir, const std::string& kind, size_t idx) {
+    return (dir / (kind + "-" + std::to_string(idx) + ".bin")).string();
+}
+
+}
+
 Engine::Engine(std::optional<std::string> path) :
     binaryDirectory(path ? CommandLine::get_binary_directory(*path) : ""),
     numaContext(NumaConfig::from_system()),
@@ -95,6 +124,9 @@ Engine::Engine(std::optional<std::string> path) :
 
     pos.set(StartFEN, false, &states->back());
 
+    if (path)
+        TimeManagement::set_calibration_directory(binaryDirectory);
+
 #ifdef HYP_FIXED_ZOBRIST
     // Bridge to allow experience.cpp to use Options["..."]
     ::Experience::g_options = &options;
@@ -120,11 +152,20 @@ Engine::Engine(std::optional<std::string> path) :
       }));
 
     options.add(  //
-      "Hash", Option(16, 1, MaxHashMB, [this](const Option& o) {
-          set_tt_size(o);
+      "Hash", Option(16, 1, MaxHashMB, [this](const Option&) {
+          set_tt_size(hash_size_mb());
           return std::nullopt;
       }));
 
+    // Sizes the hash to the cgroup memory limit of the container instead of
+    // using "Hash". Without a limit "Hash" is used unchanged.
+    options.add(  //
+      "Auto Hash", Option(false, [this](const Option&) {
+          const size_t mb = hash_size_mb();
+          set_tt_size(mb);
+          return "Hash size: " + std::to_string(mb) + " MB";
+      }));
+
     options.add(  //
       "Clear Hash", Option([this](const Option&) {
           search_clear();
@@ -134,19 +175,66 @@ Engine::Engine(std::optional<std::string> path) :
     options.add(  //
       "Ponder", Option(false));
 
+    options.add("Ponder Candidates", Option(1, 1, 8));
+
     options.add(  //
       "MultiPV", Option(1, 1, 256));
 
+    options.add("MultiPV Split", Option(false));
+
+    // "go mate N": df-pn solver tried before the search, node budget in thousands
+    options.add("Mate Solver", Option(true));
+    options.add("Mate Solver Nodes", Option(20000, 1, 10000000));
+    options.add("Mate Solver Hash", Option(64, 1, 4096));
+
+    // Cluster of engine processes sharing their deep TT entries, see cluster.h
+    options.add("Cluster Address", Option("unix:/tmp/hypnos-cluster.sock", [this](const Option&) {
+                    return cluster.role() == Distributed::Role::Off
+                           ? std::nullopt
+                           : std::optional<std::string>(configure_cluster());
+                }));
+    options.add("Cluster Role", Option(Distributed::RoleCombo, "off", [this](const Option&) {
+                    return std::optional<std::string>(configure_cluster());
+                }));
+
+    cluster.onGo = [this](const std::string& fen, const std::vector<std::string>& moves) {
+        stop();
+        wait_for_search_finished();
+        set_position(fen, moves);
+
+        Search::LimitsType limits;
+        limits.startTime = now();
+        limits.infinite  = 1;
+        go(limits);
+    };
+    cluster.onStop  = [this]() { stop(); };
+    cluster.onEntry = [this](const Distributed::Entry& e) {
+        std::lock_guard<std::mutex> lk(clusterTTMutex);
+
+        auto [ttHit, ttData, ttWriter] = tt.probe(e.key);
+        if (!ttHit || ttData.depth < e.depth)
+            ttWriter.write(e.key, e.value, e.boundPv >> 2, Bound(e.boundPv & 3), e.depth,
+                           Move(e.move), e.eval, tt.generation());
+    };
+
     options.add("Skill Level", Option(20, 0, 20));
 
     options.add("MoveOverhead", Option(25, 0, 5000));
 
+    options.add("Adaptive MoveOverhead", Option(false));
+
+    options.add("Time Policy", Option(TimePolicyCombo, "default"));
+
+    options.add("Time Log File", Option(""));
+
     options.add("Minimum Thinking Time", Option(20, 0, 5000));
 
     options.add("Slow Mover", Option(80, 10, 1000));
 
     options.add("nodestime", Option(0, 0, 10000));
 
+    options.add("Auto nodestime", Option(false));
+
     options.add("UCI_Chess960", Option(false));
 
     options.add("UCI_LimitStrength", Option(false));
@@ -155,6 +243,13 @@ Engine::Engine(std::optional<std::string> path) :
                 Option(Hypnos::Search::Skill::LowestElo, Hypnos::Search::Skill::LowestElo,
                        Hypnos::Search::Skill::HighestElo));
 
+    // Strength limited searches capped to what the level needs, on the main
+    // thread only; the NPS budget (0 = none) throttles it. The UCI_Elo to
+    // Skill Level mapping was calibrated with uncapped searches, so under the
+    // cap the engine plays weaker than the Elo it is set to.
+    options.add("Frugal Strength", Option(false));
+    options.add("Frugal NPS", Option(0, 0, 100000000));
+
 
     // Debug: print NNUE weights once per search at root (main thread)
     options.add("NNUE Log Weights", Option(false));
@@ -219,6 +314,14 @@ Engine::Engine(std::optional<std::string> path) :
                     return std::nullopt;
                 }));
 
+    options.add("Experience Max MB",
+                Option(0, 0, 1048576, [](const Option& opt) {
+                    sync_cout << "info string Experience Max MB = " << int(opt)
+                              << (int(opt) ? "" : " (unlimited)") << sync_endl;
+                    on_exp_file(opt);
+                    return std::nullopt;
+                }));
+
     options.add("Experience Readonly",
                 Option(false, [](const Option& opt) {
                     sync_cout << "info string Experience Readonly is now: "
@@ -226,6 +329,21 @@ Engine::Engine(std::optional<std::string> path) :
                     return std::nullopt;
                 }));
 
+    options.add("Experience Journal",
+                Option(false, [](const Option& opt) {
+                    sync_cout << "info string Experience Journal is now: "
+                              << (opt ? "enabled" : "disabled") << sync_endl;
+                    return std::nullopt;
+                }));
+
+    options.add("Experience Prefetch",
+                Option(false, [](const Option& opt) {
+                    Experience::g_prefetch = bool(opt);
+                    sync_cout << "info string Experience Prefetch is now: "
+                              << (opt ? "enabled" : "disabled") << sync_endl;
+                    return std::nullopt;
+                }));
+
     options.add("Experience Book",
                 Option(false, [](const Option& opt) {
                     sync_cout << "info string Experience Book is now: "
@@ -289,7 +407,9 @@ Engine::Engine(std::optional<std::string> path) :
 
     options.add("Random Open Plies",    Option(16, 0, 20));      // Active only in the first N plies
 
-    options.add("Random Open MultiPV",  Option(3,  1, 6));       // Ensure at least this MultiPV early
+    options.add("Random Open MultiPV",  Option(3,  1, 6));       // Candidates to score early
+
+    options.add("Random Open Verify",   Option(true));           // Score candidates by a reduced search, not MultiPV
 
     options.add("Random Open DeltaCp",  Option(25, 0, 100));      // Eligible window around best (centipawns)
 
@@ -310,6 +430,14 @@ Engine::Engine(std::optional<std::string> path) :
           return std::nullopt;
       }));
 
+    // Converts the piece-square weights of both nets to int8 with a per-neuron
+    // scale after loading. Files saved by export_net keep the int8 format.
+    options.add(  //
+      "NNUE Int8 PSQ", Option(false, [this](const Option&) {
+          load_networks();
+          return std::nullopt;
+      }));
+
     // --- NNUE dynamic/manual weights ---------------------------------------
     options.add("NNUE Dynamic Weights",
                 Option(true, [](const Option& opt) {
@@ -386,8 +514,116 @@ void Engine::go(Search::LimitsType& limits) {
     assert(limits.perft == 0);
     verify_networks();
 
+    // "Frugal Strength": with a strength limit, search no deeper than the
+    // depth where the weakened move is picked, cap the nodes by level and
+    // throttle to the "Frugal NPS" budget. Analysis searches are left alone.
+    // Only the main thread searches: the budget is checked against the nodes
+    // of all threads, but only the main thread sleeps off the excess.
+    const Search::Skill skill(options["Skill Level"],
+                              options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
+
+    if (options["Frugal Strength"] && skill.enabled() && !limits.infinite && !limits.mate)
+    {
+        limits.depth = limits.depth ? std::min(limits.depth, skill.max_depth()) : skill.max_depth();
+        limits.nodes = limits.nodes ? std::min(limits.nodes, skill.max_nodes()) : skill.max_nodes();
+        limits.nps   = uint64_t(int(options["Frugal NPS"]));
+
+        limits.mainThreadOnly = true;
+    }
+
+    // Speculative pondering: the alternatives to the expected reply get some
+    // of the helper threads. Needs the reply in the position's move list.
+    const int candidates = options["Ponder Candidates"];
+    threads.set_speculative_roots(limits.ponderMode && candidates > 1 && threads.size() > 1
+                                      && !limits.mainThreadOnly
+                                    ? speculative_roots(size_t(candidates - 1))
+                                    : std::vector<SpeculativeRoot>{});
+
+    cluster.start_search(positionFen, positionMoves);
+
     threads.start_thinking(options, pos, states, limits);
 }
+
+std::vector<SpeculativeRoot> Engine::speculative_roots(size_t count) const {
+    std::vector<SpeculativeRoot> roots;
+
+    if (positionMoves.empty())
+        return roots;
+
+    // Replays the game up to the expected reply, followed by 'last' if given
+    auto replay = [&](StateListPtr& s, Position& p, Move last) {
+        s = StateListPtr(new std::deque<StateInfo>(1));
+        p.set(positionFen, options["UCI_Chess960"], &s->back());
+        for (size_t i = 0; i + 1 < positionMoves.size(); ++i)
+        {
+            s->emplace_back();
+            p.do_move(UCIEngine::to_move(p, positionMoves[i]), s->back());
+        }
+        if (last != Move::none())
+        {
+            s->emplace_back();
+            p.do_move(last, s->back());
+        }
+    };
+
+    StateListPtr parentStates;
+    Position     parent;
+    replay(parentStates, parent, Move::none());
+
+    const Move expected = UCIEngine::to_move(parent, positionMoves.back());
+
+    // The other replies ranked by what the TT knows from our previous search:
+    // the lower the value for us, the more likely the opponent plays it.
+    std::vector<std::pair<Value, Move>> replies;
+    for (const auto& m : MoveList<LEGAL>(parent))
+    {
+        if (m == expected)
+            continue;
+
+        StateInfo st;
+        parent.do_move(m, st);
+        auto [ttHit, ttData, ttWriter] = tt.probe(parent.key());
+        parent.undo_move(m);
+
+        if (ttHit && is_valid(ttData.value))
+            replies.emplace_back(ttData.value, m);
+    }
+
+    std::stable_sort(replies.begin(), replies.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    replies.resize(std::min(replies.size(), count));
+
+    if (replies.empty())
+        return roots;
+
+    // The expected reply keeps the main thread and half of the helpers, the
+    // others are shared in proportion to exp(-(v - best) / 64).
+    const size_t        spare = threads.size() / 2;
+    std::vector<double> weights;
+    double              sum = 0;
+    for (auto&& [v, m] : replies)
+        sum += weights.emplace_back(std::exp(-double(v - replies[0].first) / 64));
+
+    size_t assigned = 0;
+    for (size_t i = 0; i < replies.size() && assigned < spare; ++i)
+    {
+        const size_t n = i == 0 ? std::max<size_t>(1, size_t(spare * weights[0] / sum))
+                                : std::min(spare - assigned, size_t(spare * weights[i] / sum + 0.5));
+        if (!n)
+            continue;
+
+        SpeculativeRoot root;
+        Position        p;
+        replay(root.states, p, replies[i].second);
+        root.fen     = p.fen();
+        root.threads = n;
+        roots.push_back(std::move(root));
+        assigned += n;
+    }
+
+    return roots;
+}
+
 void Engine::stop() { threads.stop = true; }
 
 void Engine::search_clear() {
@@ -427,6 +663,9 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
     states = StateListPtr(new std::deque<StateInfo>(1));
     pos.set(fen, options["UCI_Chess960"], &states->back());
 
+    positionFen = fen;
+    positionMoves.clear();
+
     for (const auto& move : moves)
     {
         auto m = UCIEngine::to_move(pos, move);
@@ -436,13 +675,14 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
 
         states->emplace_back();
         pos.do_move(m, states->back());
+        positionMoves.push_back(move);
     }
 }
 
 // modifiers
 
 void Engine::set_numa_config_from_option(const std::string& o) {
-    if (o == "auto" || o == "system")
+    if (o == "auto" || o == "system" || o == "topology")
     {
         numaContext.set_numa_config(NumaConfig::from_system());
     }
@@ -467,19 +707,58 @@ void Engine::set_numa_config_from_option(const std::string& o) {
 
 void Engine::resize_threads() {
     threads.wait_for_search_finished();
-    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks}, updateContext);
+    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks, cluster},
+                updateContext);
 
     // Reallocate the hash with the new threadpool size
-    set_tt_size(options["Hash"]);
+    set_tt_size(hash_size_mb());
     threads.ensure_network_replicated();
 }
 
 void Engine::set_tt_size(size_t mb) {
     wait_for_search_finished();
+
+    const auto& limit = STARTUP_CGROUP_LIMITS.memoryMax;
+    if (limit.has_value() && mb * 1024 * 1024 > *limit)
+        sync_cout << "info string WARNING: Hash of " << mb << " MB exceeds the cgroup memory limit of "
+                  << *limit / (1024 * 1024) << " MB" << sync_endl;
+
+    std::lock_guard<std::mutex> lk(clusterTTMutex);
     tt.resize(mb, threads);
 }
 
-void Engine::set_ponderhit(bool b) { threads.main_manager()->ponder = b; }
+size_t Engine::hash_size_mb() const {
+    const size_t requested = options["Hash"];
+    const auto&  limit     = STARTUP_CGROUP_LIMITS.memoryMax;
+
+    if (!options["Auto Hash"] || !limit.has_value())
+        return requested;
+
+    // Everything but the current hash stays allocated, and we leave a quarter
+    // of the remainder as headroom for the page cache, stacks and the like.
+    const auto usage = memory_usage();
+    size_t     other = 0;
+    for (size_t t = 0; t < usage.size(); ++t)
+        if (t != size_t(MemoryTag::TT))
+            other += usage[t].bytes;
+
+    const size_t budget = *limit > other ? (*limit - other) / 4 * 3 / (1024 * 1024) : 1;
+
+    // Round down to a power of two, as is customary for hash sizes
+    size_t mb = 1;
+    while (mb * 2 <= budget)
+        mb *= 2;
+
+    return std::min<size_t>(mb, MaxHashMB);
+}
+
+void Engine::set_ponderhit(bool b) {
+    threads.main_manager()->ponder = b;
+
+    // Speculative roots lost their purpose, their threads join the main root
+    if (!b)
+        threads.speculationOver = true;
+}
 
 // network related
 
@@ -522,6 +801,12 @@ void Engine::load_networks() {
     networks.modify_and_replicate([this](NN::Networks& networks_) {
         networks_.big.load(binaryDirectory, options["EvalFile"]);
         networks_.small.load(binaryDirectory, options["EvalFileSmall"]);
+
+        if (options["NNUE Int8 PSQ"])
+        {
+            networks_.big.quantize_psq();
+            networks_.small.quantize_psq();
+        }
     });
     threads.clear();
     threads.ensure_network_replicated();
@@ -529,14 +814,22 @@ void Engine::load_networks() {
 
 void Engine::load_big_network(const std::string& file) {
     networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.big.load(binaryDirectory, file); });
+      [this, &file](NN::Networks& networks_) {
+          networks_.big.load(binaryDirectory, file);
+          if (options["NNUE Int8 PSQ"])
+              networks_.big.quantize_psq();
+      });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
 void Engine::load_small_network(const std::string& file) {
     networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.small.load(binaryDirectory, file); });
+      [this, &file](NN::Networks& networks_) {
+          networks_.small.load(binaryDirectory, file);
+          if (options["NNUE Int8 PSQ"])
+              networks_.small.quantize_psq();
+      });
     threads.clear();
     threads.ensure_network_replicated();
 }
@@ -548,6 +841,54 @@ void Engine::save_network(const std::pair<std::optional<std::string>, std::strin
     });
 }
 
+// Reloads the big net at full precision and compares its raw output with
+// that of the net in use, which has int8 piece-square weights
+std::string Engine::psq_int8_drift(const std::vector<std::string>& fens) const {
+    if (!networks->big.psq_int8())
+        return "n/a (NNUE Int8 PSQ is off)";
+
+    auto reference = std::make_unique<NN::NetworkBig>(
+      NN::EvalFile{EvalFileDefaultNameBig, "None", ""}, NN::EmbeddedNNUEType::BIG);
+    reference->load(binaryDirectory, options["EvalFile"]);
+
+    if (reference->psq_int8())
+        return "n/a (the network file is already int8)";
+
+    auto accumulators   = std::make_unique<Eval::NNUE::AccumulatorStack>();
+    auto caches         = std::make_unique<Eval::NNUE::AccumulatorCaches>(*networks);
+    auto referenceCache = std::make_unique<Eval::NNUE::AccumulatorCaches>(*networks);
+    referenceCache->big.clear(*reference);
+
+    double sum = 0;
+    int    maxDiff = 0, count = 0;
+
+    for (const auto& fen : fens)
+    {
+        StateInfo st;
+        Position  p;
+        p.set(fen, options["UCI_Chess960"], &st);
+
+        if (p.checkers())
+            continue;
+
+        accumulators->reset();
+        auto [psqt, positional] = networks->big.evaluate(p, *accumulators, caches->big);
+        accumulators->reset();
+        auto [refPsqt, refPositional] = reference->evaluate(p, *accumulators, referenceCache->big);
+
+        const int diff = std::abs(UCIEngine::to_cp(psqt + positional, p)
+                                  - UCIEngine::to_cp(refPsqt + refPositional, p));
+        sum += diff;
+        maxDiff = std::max(maxDiff, diff);
+        count++;
+    }
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2) << "mean " << (count ? sum / count : 0.0)
+       << " cp, max " << maxDiff << " cp over " << count << " positions";
+    return ss.str();
+}
+
 // utility functions
 
 void Engine::trace_eval() const {
@@ -575,6 +916,27 @@ std::string Engine::visualize() const {
 
 int Engine::get_hashfull(int maxAge) const { return tt.hashfull(maxAge); }
 
+std::pair<std::uint64_t, std::uint64_t> Engine::pawn_table_stats() const {
+    std::uint64_t hits = 0, probes = 0;
+
+    for (auto it = threads.cbegin(); it != threads.cend(); ++it)
+    {
+        hits += (*it)->worker->pawn_table().hits();
+        probes += (*it)->worker->pawn_table().probes();
+    }
+
+    return {hits, probes};
+}
+
+std::vector<std::uint64_t> Engine::nodes_per_thread() const {
+    std::vector<std::uint64_t> nodes;
+
+    for (auto it = threads.cbegin(); it != threads.cend(); ++it)
+        nodes.push_back((*it)->worker->nodes_searched());
+
+    return nodes;
+}
+
 std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_node() const {
     auto                                   counts = threads.get_bound_thread_count_by_numa_node();
     const NumaConfig&                      cfg    = numaContext.get_numa_config();
@@ -593,8 +955,14 @@ std::string Engine::get_numa_config_as_string() const {
 }
 
 std::string Engine::numa_config_information_as_string() const {
-    auto cfgStr = get_numa_config_as_string();
-    return "Available processors: " + cfgStr;
+    std::stringstream ss;
+    ss << "Available processors: " << get_numa_config_as_string();
+
+    if (STARTUP_CGROUP_LIMITS.cpuQuota.has_value())
+        ss << " (cgroup quota: " << std::fixed << std::setprecision(2)
+           << *STARTUP_CGROUP_LIMITS.cpuQuota << " processors)";
+
+    return ss.str();
 }
 
 std::string Engine::thread_binding_information_as_string() const {
@@ -629,6 +997,235 @@ std::string Engine::thread_allocation_information_as_string() const {
     ss << " with NUMA node thread binding: ";
     ss << boundThreadsByNodeStr;
 
+    const auto& cpus = threads.get_bound_thread_cpus();
+    if (!cpus.empty())
+    {
+        ss << ", pinned to processors:";
+        for (CpuIndex c : cpus)
+            ss << ' ' << c;
+    }
+
     return ss.str();
 }
+
+std::string Engine::memory_information_as_string() const {
+    const auto usage = memory_usage();
+
+    auto mib = [](size_t bytes) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << double(bytes) / (1024 * 1024) << " MiB";
+        return ss.str();
+    };
+
+    std::stringstream ss;
+    MemoryUsage       total;
+
+    ss << "Memory by subsystem: reserved, resident, huge page share, share mapped by other processes, NUMA nodes";
+
+    for (size_t t = 0; t < usage.size(); ++t)
+    {
+        const MemoryUsage& u = usage[t];
+        if (!u.regions)
+            continue;
+
+        ss << "\n" << std::left << std::setw(11) << to_string(MemoryTag(t)) << std::right
+           << std::setw(12) << mib(u.bytes) << std::setw(12) << mib(u.resident);
+
+        if (u.resident)
+        {
+            ss << "  huge " << 100 * u.huge / u.resident << "%"
+               << "  shared " << 100 * u.shared / u.resident << "%  nodes";
+
+            for (size_t n = 0; n < u.nodes.size(); ++n)
+                if (u.nodes[n])
+                    ss << " " << n << ":" << mib(u.nodes[n]);
+        }
+        else
+            ss << "  pages n/a";
+
+        ss << "  (" << u.regions << (u.regions > 1 ? " regions)" : " region)");
+
+        // The Worker block is a single allocation per thread, split it by its largest members
+        if (MemoryTag(t) == MemoryTag::Worker)
+        {
+            const size_t stack  = sizeof(Eval::NNUE::AccumulatorStack);
+            const size_t caches = sizeof(Eval::NNUE::AccumulatorCaches);
+            const size_t pawns  = sizeof(Pawns::Table);
+
+            ss << "\n  per thread: accumulator stack " << mib(stack) << ", accumulator caches "
+               << mib(caches) << ", pawn table " << mib(pawns) << ", histories and state "
+               << mib(sizeof(Search::Worker) - stack - caches - pawns);
+        }
+
+        total.regions += u.regions;
+        total.bytes += u.bytes;
+        total.resident += u.resident;
+    }
+
+    ss << "\n" << std::left << std::setw(11) << "Total" << std::right << std::setw(12)
+       << mib(total.bytes) << std::setw(12) << mib(total.resident);
+
+    return ss.str();
+}
+
+std::string Engine::save_snapshot(const std::string& dir) {
+    wait_for_search_finished();
+
+    const std::filesystem::path root(dir);
+    std::error_code             ec;
+    std::filesystem::create_directories(root, ec);
+
+    std::ofstream meta(root / "snapshot.txt");
+    if (!meta)
+        return "Could not create snapshot in " + dir;
+
+    const TimePoint     start   = now();
+    const std::uint64_t netHash = std::hash<NN::Networks>{}(*networks);
+    const size_t        n       = threads.size();
+    const size_t        ttBytes = tt.slice(0, 1).second;
+
+    // Before the first 'position' command the engine sits at the start position
+    meta << "version " << Snapshot::Version << "\nnetwork " << netHash << "\nthreads " << n
+         << "\ntt " << ttBytes << "\ngeneration " << int(tt.generation()) << "\nfen "
+         << (positionFen.empty() ? StartFEN : positionFen) << "\nmoves";
+    for (const auto& m : positionMoves)
+        meta << " " << m;
+    meta << "\n";
+    meta.close();
+
+    // Each thread streams its own part of the TT and its own histories
+    std::vector<char> ok(n, false);
+
+    for (size_t t = 0; t < n; ++t)
+        threads.run_on_thread(t, [&, t]() {
+            const auto [data, size] = tt.slice(t, n);
+            ok[t] = Snapshot::write_file(snapshot_file(root, "tt", t), netHash, {{data, size}})
+                 && Snapshot::write_file(snapshot_file(root, "worker", t), netHash,
+                                         history_blocks(*threads.begin()[t]->worker));
+        });
+
+    for (size_t t = 0; t < n; ++t)
+        threads.wait_on_thread(t);
+
+    if (!meta || std::count(ok.begin(), ok.end(), false))
+        return "Could not write snapshot to " + dir;
+
+    return "Snapshot saved to " + dir + " in " + std::to_string(now() - start) + " ms ("
+         + std::to_string(ttBytes >> 20) + " MiB TT, " + std::to_string(n) + " threads)";
+}
+
+std::string Engine::load_snapshot(const std::string& dir) {
+    wait_for_search_finished();
+
+    const std::filesystem::path root(dir);
+    std::ifstream               meta(root / "snapshot.txt");
+    if (!meta)
+        return "No snapshot found in " + dir;
+
+    std::uint32_t            version = 0;
+    std::uint64_t            network = 0;
+    size_t                   saved = 0, ttBytes = 0;
+    int                      generation = 0;
+    std::string              line, token, fen;
+    std::vector<std::string> moves;
+
+    while (std::getline(meta, line))
+    {
+        std::istringstream ls(line);
+        ls >> token;
+
+        if (token == "version")
+            ls >> version;
+        else if (token == "network")
+            ls >> network;
+        else if (token == "threads")
+            ls >> saved;
+        else if (token == "tt")
+            ls >> ttBytes;
+        else if (token == "generation")
+            ls >> generation;
+        else if (token == "fen")
+            std::getline(ls >> std::ws, fen);
+        else if (token == "moves")
+            for (std::string m; ls >> m;)
+                moves.push_back(m);
+    }
+
+    const TimePoint     start   = now();
+    const std::uint64_t netHash = std::hash<NN::Networks>{}(*networks);
+    const size_t        n       = threads.size();
+
+    if (version != Snapshot::Version || !saved || fen.empty())
+        return "Snapshot in " + dir + " is incomplete or of another version";
+
+    if (network != netHash)
+        return "Snapshot in " + dir + " was saved with a different network, not loaded";
+
+    // TT slices are independent of the thread count but not of the table size.
+    // Histories are restored for the threads present in both configurations.
+    const bool   restoreTT = ttBytes == tt.slice(0, 1).second;
+    const size_t workers   = std::min(n, saved);
+
+    std::vector<Snapshot::ReadResult> ttResults(saved, Snapshot::ReadResult::Ok);
+    std::vector<Snapshot::ReadResult> workerResults(workers, Snapshot::ReadResult::Ok);
+
+    for (size_t t = 0; t < n; ++t)
+        threads.run_on_thread(t, [&, t]() {
+            for (size_t i = t; restoreTT && i < saved; i += n)
+            {
+                const auto [data, size] = tt.slice(i, saved);
+                ttResults[i] =
+                  Snapshot::read_file(snapshot_file(root, "tt", i), netHash, {{data, size}});
+            }
+
+            if (t < workers)
+                workerResults[t] = Snapshot::read_file(snapshot_file(root, "worker", t), netHash,
+                                                       history_blocks(*threads.begin()[t]->worker));
+        });
+
+    for (size_t t = 0; t < n; ++t)
+        threads.wait_on_thread(t);
+
+    // A damaged file leaves partial data behind, so start from a clean state
+    auto failed = [&](const std::vector<Snapshot::ReadResult>& results, const std::string& kind) {
+        for (size_t i = 0; i < results.size(); ++i)
+            if (results[i] != Snapshot::ReadResult::Ok)
+            {
+                search_clear();
+                return "Snapshot file " + snapshot_file(root, kind, i) + ": "
+                     + Snapshot::to_string(results[i]) + ", search state cleared";
+            }
+        return std::string();
+    };
+
+    for (const auto& error : {failed(ttResults, "tt"), failed(workerResults, "worker")})
+        if (!error.empty())
+            return error;
+
+    if (restoreTT)
+        tt.set_generation(uint8_t(generation));
+
+    set_position(fen, moves);
+
+    return "Snapshot loaded from " + dir + " in " + std::to_string(now() - start) + " ms ("
+         + (restoreTT ? std::to_string(ttBytes >> 20) + " MiB TT"
+                      : std::string("TT skipped, Hash differs from the snapshot"))
+         + ", histories of " + std::to_string(workers) + " threads)";
+}
+
+std::string Engine::configure_cluster() {
+    const std::string role = options["Cluster Role"];
+
+    // A worker leaves the search of its old main node
+    stop();
+    wait_for_search_finished();
+
+    return cluster.configure(role == "main"     ? Distributed::Role::Main
+                             : role == "worker" ? Distributed::Role::Worker
+                                                : Distributed::Role::Off,
+                             options["Cluster Address"]);
+}
+
+std::string Engine::cluster_status() const { return cluster.status(); }
+
 }
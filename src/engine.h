@@ -22,12 +22,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "cluster.h"
 #include "nnue/network.h"
 #include "numa.h"
 #include "position.h"
@@ -39,6 +41,10 @@
 
 namespace Hypnos {
 
+namespace Microbench {
+class Runner;
+}
+
 class Engine {
    public:
     using InfoShort = Search::InfoShort;
@@ -72,6 +78,8 @@ class Engine {
     void set_numa_config_from_option(const std::string& o);
     void resize_threads();
     void set_tt_size(size_t mb);
+    // Hash size in MB honoring "Auto Hash"
+    size_t hash_size_mb() const;
     void set_ponderhit(bool);
     void search_clear();
 
@@ -88,6 +96,16 @@ class Engine {
     void load_big_network(const std::string& file);
     void load_small_network(const std::string& file);
     void save_network(const std::pair<std::optional<std::string>, std::string> files[2]);
+    // Evaluation drift of the int8 PSQ big net against the full precision one
+    std::string psq_int8_drift(const std::vector<std::string>& fens) const;
+
+    // snapshot of the TT, the worker histories and the position, see snapshot.h
+
+    std::string save_snapshot(const std::string& dir);
+    std::string load_snapshot(const std::string& dir);
+
+    // peers and traffic of the cluster node, see cluster.h
+    std::string cluster_status() const;
 
     // utility functions
 
@@ -97,6 +115,9 @@ class Engine {
     OptionsMap&       get_options();
 
     int get_hashfull(int maxAge = 0) const;
+    // Hits and probes of the pawn tables, summed over all threads
+    std::pair<std::uint64_t, std::uint64_t> pawn_table_stats() const;
+    std::vector<std::uint64_t>              nodes_per_thread() const;
 
     std::string                            fen() const;
     void                                   flip();
@@ -106,6 +127,7 @@ class Engine {
     std::string                            numa_config_information_as_string() const;
     std::string                            thread_allocation_information_as_string() const;
     std::string                            thread_binding_information_as_string() const;
+    std::string                            memory_information_as_string() const;
 
    private:
     const std::string binaryDirectory;
@@ -115,6 +137,13 @@ class Engine {
     Position     pos;
     StateListPtr states;
 
+    // The current position as given, to derive speculative ponder roots
+    std::string              positionFen;
+    std::vector<std::string> positionMoves;
+
+    std::vector<SpeculativeRoot> speculative_roots(size_t count) const;
+    std::string                  configure_cluster();
+
     OptionsMap                                         options;
     ThreadPool                                         threads;
     TranspositionTable                                 tt;
@@ -122,6 +151,14 @@ class Engine {
 
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
+
+    // Declared last, so that its network thread stops before the rest goes.
+    // The mutex keeps the entries it receives away from a TT being resized.
+    std::mutex        clusterTTMutex;
+    Distributed::Node cluster;
+
+    // The microbenchmark harness drives the TT, threads and networks directly
+    friend class Microbench::Runner;
 };
 
 }  // namespace Hypnos
@@ -31,6 +31,7 @@
 
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
+#include "pawns.h"
 #include "position.h"
 #include "types.h"
 #include "uci.h"
@@ -71,9 +72,8 @@ int developed_minors(const Position& pos, Color c) {
 
 // Penalize early structural concessions by Black (doubled/isolated pawns)
 // unless there is an evident lead in development/initiative.
-int early_black_pawn_penalty(const Position& pos) {
-    Bitboard pawns = pos.pieces(BLACK, PAWN);
-    if (!pawns)
+int early_black_pawn_penalty(const Position& pos, Pawns::Table& pawnTable) {
+    if (!pos.pieces(BLACK, PAWN))
         return 0;
 
     // Focus on the early game where long-term pawn weaknesses hurt most.
@@ -81,29 +81,7 @@ int early_black_pawn_penalty(const Position& pos) {
     if (!earlyFactor)
         return 0;
 
-    const Bitboard allBlackPawns = pawns;
-    int            penalty       = 0;
-
-    while (pawns)
-    {
-        const Square sq    = pop_lsb(pawns);
-        const File   file  = file_of(sq);
-        Bitboard     adj   = 0;
-
-        if (file > FILE_A)
-            adj |= file_bb(File(file - 1));
-        if (file < FILE_H)
-            adj |= file_bb(File(file + 1));
-
-        const bool isolated = !(allBlackPawns & adj);
-        const int  pawnsOnFile = popcount(allBlackPawns & file_bb(file));
-        const bool doubled     = pawnsOnFile > 1;
-
-        if (isolated)
-            penalty += 14;
-        if (doubled)
-            penalty += 10;
-    }
+    const int penalty = pawnTable.probe(pos).blackWeaknesses;
 
     // Reward clear signs of activity as compensation.
     const int devLead = developed_minors(pos, BLACK) - developed_minors(pos, WHITE)
@@ -134,6 +112,7 @@ Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
                      const Position&                pos,
                      Eval::NNUE::AccumulatorStack&  accumulators,
                      Eval::NNUE::AccumulatorCaches& caches,
+                     Pawns::Table&                  pawnTable,
                      int                            optimism) {
 
     assert(!pos.checkers());
@@ -263,7 +242,7 @@ Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
     // Hand-crafted guardrails for speculative structures not fully captured by
     // the nets: discourage early Black pawn weaknesses without visible
     // compensation in development/initiative.
-    const int blackStructuralPenalty = early_black_pawn_penalty(pos);
+    const int blackStructuralPenalty = early_black_pawn_penalty(pos, pawnTable);
     if (blackStructuralPenalty)
         v += pos.side_to_move() == WHITE ? blackStructuralPenalty : -blackStructuralPenalty;
 
@@ -287,6 +266,7 @@ std::string Eval::trace(Position& pos, const Eval::NNUE::Networks& networks) {
 
     auto accumulators = std::make_unique<Eval::NNUE::AccumulatorStack>();
     auto caches       = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
+    auto pawnTable    = std::make_unique<Pawns::Table>();
 
     std::stringstream ss;
     ss << std::showpoint << std::noshowpos << std::fixed << std::setprecision(2);
@@ -299,7 +279,7 @@ std::string Eval::trace(Position& pos, const Eval::NNUE::Networks& networks) {
     v                       = pos.side_to_move() == WHITE ? v : -v;
     ss << "NNUE evaluation        " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)\n";
 
-    v = evaluate(networks, pos, *accumulators, *caches, VALUE_ZERO);
+    v = evaluate(networks, pos, *accumulators, *caches, *pawnTable, VALUE_ZERO);
     v = pos.side_to_move() == WHITE ? v : -v;
     ss << "Final evaluation       " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)";
     ss << " [with scaled NNUE, ...]";
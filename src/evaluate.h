@@ -27,6 +27,10 @@ namespace Hypnos {
 
 class Position;
 
+namespace Pawns {
+class Table;
+}
+
 namespace Eval {
 
 // The default net name MUST follow the format nn-[SHA256 first 12 digits].nnue
@@ -52,6 +56,7 @@ Value evaluate(const NNUE::Networks&          networks,
                const Position&                pos,
                Eval::NNUE::AccumulatorStack&  accumulators,
                Eval::NNUE::AccumulatorCaches& caches,
+               Pawns::Table&                  pawnTable,
                int                            optimism);
 }  // namespace Eval
 
@@ -16,7 +16,9 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <string>
@@ -26,13 +28,16 @@
 #include <cstdio>  //For: remove()
 #include <condition_variable>
 #include <mutex>
+#include <queue>
 #include <thread>
 #include <unordered_set>
 #include <type_traits>
+#include "memory.h"
 #include "misc.h"
 #include "movegen.h" 
 #include "position.h"
 #include "thread.h"
+#include "trace.h"
 #include "experience.h"
 #include "uci.h"
 #include "experience_compat.h"
@@ -377,6 +382,594 @@ constexpr usize WriteBufferSize = 1024;
 constexpr usize WriteBufferSize = 1024 * 1024 * 16;
 #endif
 
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Journal of the entries learned since the last export ("Experience Journal"),
+// kept next to the experience file. Records are packed: key (8 bytes), move (2),
+// value (2), depth (1) and count (2).
+constexpr auto  JournalSignature  = "Hypnos Experience journal 1";
+constexpr usize JournalRecordSize = 15;
+
+void pack_journal_record(const Current::ExpEntry& e, char* out) {
+    const u16          move  = e.move.raw();
+    const std::int16_t value = static_cast<std::int16_t>(std::clamp(int(e.value), -32767, 32767));
+    const u8           depth = static_cast<u8>(std::clamp(int(e.depth), 0, 255));
+
+    std::memcpy(out, &e.key, 8);
+    std::memcpy(out + 8, &move, 2);
+    std::memcpy(out + 10, &value, 2);
+    std::memcpy(out + 12, &depth, 1);
+    std::memcpy(out + 13, &e.count, 2);
+}
+
+void unpack_journal_record(const char* in, Current::ExpEntry& e) {
+    u16          move;
+    std::int16_t value;
+    u8           depth;
+
+    std::memcpy(&e.key, in, 8);
+    std::memcpy(&move, in + 8, 2);
+    std::memcpy(&value, in + 10, 2);
+    std::memcpy(&depth, in + 12, 1);
+    std::memcpy(&e.count, in + 13, 2);
+
+    e.move  = ExpMove(move);
+    e.value = ExpValue(value);
+    e.depth = ExpDepth(depth);
+}
+
+std::string journal_filename(const std::string& fn) { return Utility::map_path(fn) + ".journal"; }
+
+// Deltas already imported into an experience file are listed next to it, one
+// line per import: the number of records and the digest of those records.
+// Exporting appends to an existing delta, so a delta is compared by prefix.
+// The digest is FNV-1a (64 bit) over the packed records: the list outlives
+// the binary, so it must not depend on the compiler or the standard library.
+std::string imported_filename(const std::string& fn) { return fn + ".imported"; }
+
+constexpr std::uint64_t DigestBasis = 0xcbf29ce484222325ULL;
+constexpr std::uint64_t DigestPrime = 0x100000001b3ULL;
+
+void digest_journal_record(std::uint64_t& digest, const char* record) {
+    for (usize i = 0; i < JournalRecordSize; ++i)
+        digest = (digest ^ u8(record[i])) * DigestPrime;
+}
+
+// Number of leading records of the delta read from 'in' already imported into
+// 'fn'. Also returns the digest of all of its 'count' records.
+usize imported_records(const std::string& fn, std::ifstream& in, const usize count, std::uint64_t& digest) {
+    std::vector<std::pair<usize, std::uint64_t>> imports;
+    std::ifstream                               log(imported_filename(fn));
+
+    for (std::pair<usize, std::uint64_t> p; log >> p.first >> p.second;)
+        imports.push_back(p);
+
+    std::sort(imports.begin(), imports.end());
+
+    std::vector<char> records(4096 * JournalRecordSize);
+    usize             skip = 0;
+    auto              next = imports.begin();
+
+    digest = DigestBasis;
+
+    for (usize done = 0; done < count;)
+    {
+        const usize n = std::min<usize>(4096, count - done);
+
+        if (!in.read(records.data(), n * JournalRecordSize))
+            return 0;
+
+        for (usize i = 0; i < n; ++i)
+        {
+            digest_journal_record(digest, records.data() + i * JournalRecordSize);
+
+            for (++done; next != imports.end() && next->first <= done; ++next)
+                if (next->first == done && next->second == digest)
+                    skip = done;
+        }
+    }
+
+    return skip;
+}
+
+// Appends the entries to the journal of the experience file 'fn'
+bool append_journal(const std::string& fn, const std::vector<const ExpEntryEx*>& entries) {
+    if (entries.empty())
+        return true;
+
+    std::ofstream out(journal_filename(fn), std::ios::out | std::ios::binary | std::ios::app);
+
+    if (!out.is_open())
+        return false;
+
+    if (out.tellp() == 0)
+        out << JournalSignature;
+
+    std::vector<char> buffer(entries.size() * JournalRecordSize);
+    for (usize i = 0; i < entries.size(); ++i)
+        pack_journal_record(*entries[i], buffer.data() + i * JournalRecordSize);
+
+    out.write(buffer.data(), buffer.size());
+    return bool(out);
+}
+
+// Bounded loading ("Experience Max MB"): when a file does not fit the budget,
+// all of its entries are sorted by key into an index file next to it and only
+// the most valuable ones are linked in memory. The index is then probed for
+// the positions close to the root of each search.
+constexpr auto  IndexSignature   = "Hypnos Experience index 1";
+constexpr usize IndexFenceStride = 128;   // Index entries per in-memory fence key
+constexpr usize IndexScanChunk   = 4096;  // Index entries read at once when scanning
+constexpr int   OpeningPlies     = 12;    // Depth of the walk from the start position
+constexpr int   RootProbePlies   = 2;     // Plies from the root probed on disk
+constexpr usize RootCacheSize    = 4096;  // Entries read from disk for one search
+constexpr int   RankLevels       = 512;
+
+// Memory of one entry linked in a map: the entry itself plus up to four slots
+// of the dense map, which doubles its size when half full.
+constexpr usize EntryCost   = sizeof(ExpEntryEx) + 4 * sizeof(std::pair<Key, ExpEntryEx*>);
+constexpr usize OpeningCost = 4 * sizeof(std::pair<Key, int>);
+
+// Plain copy of an experience entry, sorted and merged while building the index
+struct ExpRecord {
+    ExpKey   key;
+    ExpMove  move;
+    ExpValue value;
+    ExpDepth depth;
+    u16      count;
+    u8       padding[2];
+
+    bool operator<(const ExpRecord& r) const {
+        return key != r.key ? key < r.key : move.raw() < r.move.raw();
+    }
+
+    bool same(const ExpRecord& r) const { return key == r.key && move == r.move; }
+};
+
+// Entries of every file version have the size of a record after the signature
+static_assert(sizeof(ExpRecord) == sizeof(Current::ExpEntry));
+static_assert(sizeof(ExpRecord) == sizeof(V1::ExpEntry));
+
+// The bytes between the fields are cleared too: records are written as they are
+ExpRecord to_record(const Current::ExpEntry& e) {
+    ExpRecord r;
+    std::memset(&r, 0, sizeof(r));
+
+    r.key   = e.key;
+    r.move  = e.move;
+    r.value = e.value;
+    r.depth = e.depth;
+    r.count = e.count;
+    return r;
+}
+
+// Same semantics as ExpEntry::merge()
+void merge_record(ExpRecord& r, const ExpRecord& other) {
+    Current::ExpEntry       a(r.key, r.move, r.value, r.depth, r.count);
+    const Current::ExpEntry b(other.key, other.move, other.value, other.depth, other.count);
+
+    a.merge(&b);
+    r = to_record(a);
+}
+
+// Sorted experience entries on disk. The header stores the size and the last
+// bytes of the experience file it was built from. When entries are appended
+// to that file, extend() merges them into the index, while any other change
+// needs a new build(). Not thread safe: it is used by the loader thread and,
+// once loading is finished, by the main thread at search start.
+class ExperienceIndex {
+   public:
+    struct SourceId {
+        std::uint64_t size;
+        std::uint64_t tail;
+    };
+
+    bool is_open() const { return _in.is_open(); }
+    usize size() const { return _size; }
+    usize memory() const { return _fences.capacity() * sizeof(Key); }
+
+    void close() {
+        _in.close();
+        _fences.clear();
+        _fences.shrink_to_fit();
+        _size = 0;
+    }
+
+    // Opens the index built for the experience file identified by 'source'
+    bool open(const std::string& path, const SourceId& source, const std::atomic<bool>& abort) {
+        close();
+        _in.open(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+        if (!_in.is_open())
+            return false;
+
+        const usize fileSize  = _in.tellg();
+        const usize sigLength = strlen(IndexSignature);
+        std::string signature(sigLength, '\0');
+        std::uint64_t header[3] = {0, 0, 0};
+
+        _in.seekg(0);
+        _in.read(signature.data(), sigLength);
+        _in.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        _dataOffset = sigLength + sizeof(header);
+
+        if (!_in || signature != IndexSignature || header[0] != source.size
+            || header[1] != source.tail || fileSize != _dataOffset + header[2] * sizeof(ExpRecord))
+        {
+            close();
+            return false;
+        }
+
+        // Keep the first key of each block of entries in memory
+        _size = header[2];
+        _fences.reserve(_size / IndexFenceStride + 1);
+
+        usize i = 0;
+        if (!scan(abort, [&](const ExpRecord& r) {
+                if (i++ % IndexFenceStride == 0)
+                    _fences.push_back(r.key);
+            }))
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // Reads the source a complete index was built for, without opening it
+    static bool read_source(const std::string& path, SourceId& source) {
+        std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+
+        const usize   fileSize  = in.tellg();
+        const usize   sigLength = strlen(IndexSignature);
+        std::string   signature(sigLength, '\0');
+        std::uint64_t header[3] = {0, 0, 0};
+
+        in.seekg(0);
+        in.read(signature.data(), sigLength);
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+
+        source = {header[0], header[1]};
+        return in && signature == IndexSignature
+            && fileSize == sigLength + sizeof(header) + header[2] * sizeof(ExpRecord);
+    }
+
+    // Sorts the 'count' entries read from 'in' into a new index. Sorted runs of
+    // at most 'bufferSize' bytes are written next to the index and merged.
+    bool build(const std::string&       path,
+               std::ifstream&           in,
+               ExperienceReader&        reader,
+               const usize              count,
+               const SourceId&          source,
+               const usize              bufferSize,
+               const std::atomic<bool>& abort) {
+        close();
+
+        const usize runSize = std::max(bufferSize / sizeof(ExpRecord), IndexScanChunk);
+
+        std::vector<ExpRecord>   buffer;
+        std::vector<std::string> runs;
+        Current::ExpEntry        entry(ExpKey{0}, ExpMove::none(), (ExpValue) 0, (ExpDepth) 0, 0);
+
+        auto remove_runs = [&]() {
+            for (const auto& run : runs)
+                std::remove(run.c_str());
+        };
+
+        // Sort the buffer, merge duplicate moves and write it as a run
+        auto write_run = [&]() -> bool {
+            sort_unique(buffer);
+
+            runs.push_back(path + ".run" + std::to_string(runs.size()));
+            std::ofstream out(runs.back(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(buffer.data()),
+                      buffer.size() * sizeof(ExpRecord));
+
+            buffer.clear();
+            return bool(out);
+        };
+
+        buffer.reserve(std::min(runSize, count));
+
+        for (usize i = 0; i < count; ++i)
+        {
+            if (abort.load(std::memory_order_relaxed) || !reader.read(in, &entry))
+            {
+                remove_runs();
+                return false;
+            }
+
+            buffer.push_back(to_record(entry));
+
+            if (buffer.size() == runSize && !write_run())
+            {
+                remove_runs();
+                return false;
+            }
+        }
+
+        if (!buffer.empty() && !write_run())
+        {
+            remove_runs();
+            return false;
+        }
+
+        std::vector<ExpRecord>().swap(buffer);
+
+        // Merge the runs, each one read through its share of the buffer
+        const usize               runBuffer = std::max(runSize / runs.size(), IndexFenceStride);
+        std::vector<RecordReader> readers(runs.size());
+
+        using HeapItem = std::pair<ExpRecord, usize>;
+        auto greater   = [](const HeapItem& a, const HeapItem& b) { return b.first < a.first; };
+        std::priority_queue<HeapItem, std::vector<HeapItem>, decltype(greater)> heap(greater);
+
+        for (usize i = 0; i < runs.size(); ++i)
+        {
+            readers[i].open(runs[i], 0, runBuffer);
+
+            ExpRecord r;
+            if (readers[i].next(r))
+                heap.emplace(r, i);
+        }
+
+        IndexWriter writer(path, source);
+
+        while (!heap.empty() && !abort.load(std::memory_order_relaxed))
+        {
+            auto [r, i] = heap.top();
+            heap.pop();
+
+            writer.add(r);
+
+            if (readers[i].next(r))
+                heap.emplace(r, i);
+        }
+
+        const bool written = writer.finish();
+
+        readers.clear();
+        remove_runs();
+
+        if (!written || abort.load(std::memory_order_relaxed))
+        {
+            std::remove(path.c_str());
+            return false;
+        }
+
+        return open(path, source, abort);
+    }
+
+    // Merges the 'count' entries appended to the experience file since the
+    // index at 'path' was built, read from 'in', into a new index for 'source'.
+    // Only the new entries are sorted, the indexed ones are streamed through.
+    // Fails when the new entries do not fit 'bufferSize', the caller then
+    // building the index again.
+    bool extend(const std::string&       path,
+                std::ifstream&           in,
+                ExperienceReader&        reader,
+                const usize              count,
+                const SourceId&          source,
+                const usize              bufferSize,
+                const std::atomic<bool>& abort) {
+        close();
+
+        if (count * sizeof(ExpRecord) > std::max(bufferSize, IndexScanChunk * sizeof(ExpRecord)))
+            return false;
+
+        std::vector<ExpRecord> added;
+        Current::ExpEntry      entry(ExpKey{0}, ExpMove::none(), (ExpValue) 0, (ExpDepth) 0, 0);
+
+        added.reserve(count);
+
+        for (usize i = 0; i < count; ++i)
+        {
+            if (abort.load(std::memory_order_relaxed) || !reader.read(in, &entry))
+                return false;
+
+            added.push_back(to_record(entry));
+        }
+
+        sort_unique(added);
+
+        const std::string tmpPath = path + ".tmp";
+        RecordReader      indexed;
+        ExpRecord         r;
+
+        indexed.open(path, strlen(IndexSignature) + 3 * sizeof(std::uint64_t), IndexScanChunk);
+
+        IndexWriter writer(tmpPath, source);
+        bool        more = indexed.next(r);
+        usize       next = 0;
+
+        // Same key and move: the indexed entry comes first and the new one
+        // is merged into it, as when the file is read in order
+        while ((more || next < added.size()) && !abort.load(std::memory_order_relaxed))
+            if (more && (next == added.size() || !(added[next] < r)))
+            {
+                writer.add(r);
+                more = indexed.next(r);
+            }
+            else
+                writer.add(added[next++]);
+
+        indexed.close();
+
+        if (!writer.finish() || abort.load(std::memory_order_relaxed))
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+
+        std::remove(path.c_str());
+
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+
+        return open(path, source, abort);
+    }
+
+    // Calls fn() for every entry of the index, in key order
+    template<typename Fn>
+    bool scan(const std::atomic<bool>& abort, Fn&& fn) {
+        std::vector<ExpRecord> chunk(IndexScanChunk);
+
+        _in.clear();
+        _in.seekg(_dataOffset);
+
+        for (usize done = 0; done < _size; done += chunk.size())
+        {
+            if (abort.load(std::memory_order_relaxed))
+                return false;
+
+            chunk.resize(std::min(IndexScanChunk, _size - done));
+            if (!_in.read(reinterpret_cast<char*>(chunk.data()), chunk.size() * sizeof(ExpRecord)))
+                return false;
+
+            for (const auto& r : chunk)
+                fn(r);
+        }
+
+        return true;
+    }
+
+    // Reads the entries of 'k', at most a couple of blocks past the fence keys
+    bool lookup(const Key k, std::vector<ExpRecord>& records) {
+        records.clear();
+
+        const auto it    = std::lower_bound(_fences.begin(), _fences.end(), k);
+        usize      block = it == _fences.begin() ? 0 : usize(it - _fences.begin()) - 1;
+
+        ExpRecord buffer[IndexFenceStride];
+
+        for (; block < _fences.size(); ++block)
+        {
+            const usize first = block * IndexFenceStride;
+            const usize n     = std::min(IndexFenceStride, _size - first);
+
+            _in.clear();
+            _in.seekg(_dataOffset + first * sizeof(ExpRecord));
+
+            if (!_in.read(reinterpret_cast<char*>(buffer), n * sizeof(ExpRecord)))
+                return false;
+
+            for (usize i = 0; i < n; ++i)
+            {
+                if (buffer[i].key == k)
+                    records.push_back(buffer[i]);
+                else if (buffer[i].key > k)
+                    return !records.empty();
+            }
+        }
+
+        return !records.empty();
+    }
+
+   private:
+    // Sorts the records and merges those of the same position and move
+    static void sort_unique(std::vector<ExpRecord>& records) {
+        std::sort(records.begin(), records.end());
+
+        usize n = 0;
+        for (usize i = 0; i < records.size(); ++i)
+            if (n && records[n - 1].same(records[i]))
+                merge_record(records[n - 1], records[i]);
+            else
+                records[n++] = records[i];
+
+        records.resize(n);
+    }
+
+    // Reads the records of a file from 'offset' on, 'bufferSize' at a time
+    class RecordReader {
+       public:
+        void open(const std::string& path, const usize offset, const usize bufferSize) {
+            _in.open(path, std::ios::in | std::ios::binary);
+            _in.seekg(offset);
+            _data.resize(bufferSize);
+            _pos = bufferSize;
+        }
+
+        void close() { _in.close(); }
+
+        bool next(ExpRecord& r) {
+            if (_pos == _data.size())
+            {
+                _in.read(reinterpret_cast<char*>(_data.data()), _data.size() * sizeof(ExpRecord));
+                _data.resize(_in.gcount() / sizeof(ExpRecord));
+                _pos = 0;
+
+                if (_data.empty())
+                    return false;
+            }
+
+            r = _data[_pos++];
+            return true;
+        }
+
+       private:
+        std::ifstream          _in;
+        std::vector<ExpRecord> _data;
+        usize                  _pos = 0;
+    };
+
+    // Writes records in key order to a new index, merging those of the same
+    // position and move
+    class IndexWriter {
+       public:
+        IndexWriter(const std::string& path, const SourceId& source) :
+            _out(path, std::ios::out | std::ios::binary | std::ios::trunc),
+            _header{source.size, source.tail, 0} {
+            _out.write(IndexSignature, strlen(IndexSignature));
+            _out.write(reinterpret_cast<const char*>(_header), sizeof(_header));
+            _output.reserve(IndexScanChunk);
+        }
+
+        void add(const ExpRecord& r) {
+            if (!_output.empty() && _output.back().same(r))
+                merge_record(_output.back(), r);
+            else
+            {
+                if (_output.size() == IndexScanChunk)
+                    flush();
+
+                _output.push_back(r);
+            }
+        }
+
+        // Writes the final count in the header
+        bool finish() {
+            flush();
+            _out.seekp(strlen(IndexSignature) + 2 * sizeof(std::uint64_t));
+            _out.write(reinterpret_cast<const char*>(&_header[2]), sizeof(_header[2]));
+            _out.close();
+            return bool(_out);
+        }
+
+       private:
+        void flush() {
+            _out.write(reinterpret_cast<const char*>(_output.data()),
+                       _output.size() * sizeof(ExpRecord));
+            _header[2] += _output.size();
+            _output.clear();
+        }
+
+        std::ofstream          _out;
+        std::uint64_t          _header[3];
+        std::vector<ExpRecord> _output;
+    };
+
+    std::ifstream    _in;
+    std::vector<Key> _fences;
+    usize            _size       = 0;
+    usize            _dataOffset = 0;
+};
+
 class ExperienceData {
    private:
     std::string _filename;
@@ -388,6 +981,13 @@ class ExperienceData {
 
     ExpMap _mainExp;
 
+    // Bounded loading: budget in bytes (0 = unlimited), index of the whole file
+    // and the entries read from it for the positions near the current root
+    usize           _maxBytes;
+    ExperienceIndex _index;
+    ExpMap          _rootExp;
+    ExpEntryEx*     _rootData;
+
     bool                    _loading;
     std::atomic<bool>       _abortLoading;
     std::atomic<bool>       _loadingResult;
@@ -407,16 +1007,65 @@ class ExperienceData {
 
         // Free main exp data
         for (ExpEntryEx*& p : _expData)
+        {
+            memory_untrack(p);
             free(p);
+        }
 
         // Delete previous game experience data
         for (ExpEntryEx*& p : _oldExpData)
             delete p;
 
+        // Free the entries read from the index
+        if (_rootData)
+        {
+            memory_untrack(_rootData);
+            free(_rootData);
+            _rootData = nullptr;
+        }
+
         // Clear
         _mainExp.clear();
+        _rootExp.clear();
         _oldExpData.clear();
         _expData.clear();
+        _index.close();
+    }
+
+    // New entries worth saving, PV ones first: deep enough and one per position
+    // and move within the batch
+    std::vector<const ExpEntryEx*> new_exp(usize& pvCount) const {
+        std::vector<const ExpEntryEx*> entries;
+        std::unordered_set<uint64_t>   seen;
+
+        // NOTE: do NOT cast e->move; read its raw bytes instead.
+        auto km_hash = [](const ExpEntryEx* e) -> uint64_t {
+            uint64_t mv = 0;
+            const size_t n = (sizeof(mv) < sizeof(e->move)) ? sizeof(mv) : sizeof(e->move);
+            std::memcpy(&mv, &e->move, n);
+            return static_cast<uint64_t>(e->key) ^ (mv * 0x9E3779B185EBCA87ULL);
+        };
+
+        pvCount = 0;
+
+        for (const auto* expList : {&_newPvExp, &_newMultiPvExp})
+        {
+            for (const ExpEntryEx* exp : *expList)
+            {
+                if (exp->depth < MinDepth)
+                    continue;
+
+                if (!seen.insert(km_hash(exp)).second)
+                    continue; // skip duplicate (same position key + move)
+
+                entries.push_back(exp);
+
+                if (expList == &_newPvExp)
+                    ++pvCount;
+            }
+        }
+
+        return entries;
     }
 
     void clear_new_exp() {
@@ -429,13 +1078,15 @@ class ExperienceData {
         _newMultiPvExp.clear();
     }
 
-    bool link_entry(ExpEntryEx* exp) {
-        ExpIterator itr = _mainExp.find(exp->key);
+    bool link_entry(ExpEntryEx* exp) { return link_entry(_mainExp, exp); }
+
+    static bool link_entry(ExpMap& expMap, ExpEntryEx* exp) {
+        ExpIterator itr = expMap.find(exp->key);
 
         // If new entry: insert into map and continue
-        if (itr == _mainExp.end())
+        if (itr == expMap.end())
         {
-            _mainExp[exp->key] = exp;
+            expMap[exp->key] = exp;
             return true;
         }
 
@@ -551,8 +1202,13 @@ class ExperienceData {
             sync_cout << "info string Importing experience version (" << reader->get_version()
                       << ") from file [" << fn << "]" << sync_endl;
 
-        // Allocate buffer for ExpEntryEx data
         const usize expCount = reader->entries_count();
+
+        // Too large for the memory budget: keep the best entries only
+        if (_maxBytes && expCount * EntryCost > _maxBytes)
+            return _load_bounded(fn, in, inSize, *reader);
+
+        // Allocate buffer for ExpEntryEx data
         auto*       expData  = (ExpEntryEx*) malloc(expCount * sizeof(ExpEntryEx));
 
         if (!expData)
@@ -597,6 +1253,7 @@ class ExperienceData {
 
         // Add buffer to vector so that it will be released later
         _expData.push_back(expData);
+        memory_track(expData, expCount * sizeof(ExpEntryEx), MemoryTag::Experience);
 
         // Stop if aborted
         if (_abortLoading.load(std::memory_order_relaxed))
@@ -645,6 +1302,215 @@ class ExperienceData {
         return true;
     }
 
+    static void set_entry(ExpEntryEx* exp, const ExpRecord& r) {
+        exp->key        = r.key;
+        exp->move       = r.move;
+        exp->value      = r.value;
+        exp->depth      = r.depth;
+        exp->count      = r.count;
+        exp->padding[0] = exp->padding[1] = 0x00;
+        exp->next       = nullptr;
+    }
+
+    // Walks the experience moves from the start position through the index and
+    // records the distance in plies of every position reached
+    void collect_opening(SugaRKeyMap<int>& opening, const usize limit) {
+        StateInfo states[OpeningPlies + 1];
+        Position  pos;
+        pos.set(StartFEN, false, &states[0]);
+
+        auto visit = [&](auto&& self, const int ply) -> void {
+            if (opening.size() >= limit || _abortLoading.load(std::memory_order_relaxed))
+                return;
+
+            const auto itr = opening.find(pos.key());
+            if (itr != opening.end() && itr->second <= ply)
+                return;
+
+            opening[pos.key()] = ply;
+
+            std::vector<ExpRecord> moves;
+            if (ply == OpeningPlies || !_index.lookup(pos.key(), moves))
+                return;
+
+            for (const auto& r : moves)
+                if (r.depth >= MinDepth && r.move.is_ok() && pos.pseudo_legal(r.move)
+                    && pos.legal(r.move))
+                {
+                    pos.do_move(r.move, states[ply + 1], nullptr);
+                    self(self, ply + 1);
+                    pos.undo_move(r.move);
+                }
+        };
+
+        visit(visit, 0);
+    }
+
+    // Value of an entry when the budget is short: depth, then count, and a
+    // bonus for the positions near the start position
+    static int rank(const ExpRecord& r, const SugaRKeyMap<int>& opening) {
+        int score = std::clamp(int(r.depth), 0, 63) + (r.count ? 4 * (1 + int(msb(r.count))) : 0);
+
+        const auto itr = opening.find(r.key);
+        if (itr != opening.end())
+            score += 64 + 16 * (OpeningPlies - itr->second);
+
+        assert(score < RankLevels);
+        return score;
+    }
+
+    // Number of entries appended to the experience file read by 'in' since the
+    // index at 'indexFn' was built, 0 when the indexed part of the file has
+    // changed too. Leaves 'in' on the first appended entry.
+    static usize appended_entries(const std::string& indexFn,
+                                  std::ifstream&     in,
+                                  const usize        entriesPos) {
+        ExperienceIndex::SourceId indexed;
+        std::uint64_t             tail = 0;
+
+        if (!ExperienceIndex::read_source(indexFn, indexed) || indexed.size < entriesPos
+            || indexed.size < sizeof(tail) || (indexed.size - entriesPos) % sizeof(ExpRecord))
+            return 0;
+
+        in.clear();
+        in.seekg(0, std::ios::end);
+        const usize inSize = in.tellg();
+
+        if (indexed.size >= inSize)
+            return 0;
+
+        in.seekg(indexed.size - sizeof(tail));
+        in.read(reinterpret_cast<char*>(&tail), sizeof(tail));
+
+        return in && tail == indexed.tail ? (inSize - indexed.size) / sizeof(ExpRecord) : 0;
+    }
+
+    bool _load_bounded(const std::string&  fn,
+                       std::ifstream&      in,
+                       const usize         inSize,
+                       ExperienceReader&   reader) {
+        const std::string indexFn = Utility::map_path(fn) + ".idx";
+
+        // Identify the file by its size and its last bytes
+        ExperienceIndex::SourceId source{inSize, 0};
+        const auto                entriesPos = in.tellg();
+
+        in.seekg(inSize - sizeof(source.tail));
+        in.read(reinterpret_cast<char*>(&source.tail), sizeof(source.tail));
+        in.seekg(entriesPos);
+
+        bool ready = _index.open(indexFn, source, _abortLoading);
+
+        if (!ready && !_abortLoading.load(std::memory_order_relaxed))
+        {
+            // Entries appended since the index was built are merged into it
+            const usize appended = appended_entries(indexFn, in, usize(std::streamoff(entriesPos)));
+
+            if (appended)
+            {
+                sync_cout << "info string Extending experience index [" << indexFn << "] with "
+                          << appended << " entries" << sync_endl;
+
+                ready = _index.extend(indexFn, in, reader, appended, source, _maxBytes,
+                                      _abortLoading);
+
+                in.clear();
+                in.seekg(entriesPos);
+            }
+        }
+
+        if (!ready)
+        {
+            if (_abortLoading.load(std::memory_order_relaxed))
+                return false;
+
+            sync_cout << "info string Building experience index [" << indexFn << "]" << sync_endl;
+
+            if (!_index.build(indexFn, in, reader, reader.entries_count(), source, _maxBytes,
+                              _abortLoading))
+            {
+                if (!_abortLoading.load(std::memory_order_relaxed))
+                    sync_cout << "info string Failed to build experience index [" << indexFn
+                              << "]" << sync_endl;
+                return false;
+            }
+        }
+
+        in.close();
+
+        // Split the budget: fence keys and entries read near the root first,
+        // then the opening walk, then the entries kept in memory
+        const usize reserved = _index.memory() + RootCacheSize * EntryCost;
+        usize       room     = _maxBytes > reserved ? _maxBytes - reserved : 0;
+
+        const usize openingLimit = room / 16 / OpeningCost;
+        room -= openingLimit * OpeningCost;
+
+        const usize capacity = room / EntryCost;
+
+        SugaRKeyMap<int> opening;
+        collect_opening(opening, openingLimit);
+
+        // Count the entries of each rank and find the lowest rank that fits
+        std::vector<usize> histogram(RankLevels);
+        if (!_index.scan(_abortLoading,
+                         [&](const ExpRecord& r) { ++histogram[rank(r, opening)]; }))
+            return false;
+
+        int   threshold = RankLevels;
+        usize kept      = 0;
+
+        while (threshold > 0 && kept + histogram[threshold - 1] <= capacity)
+            kept += histogram[--threshold];
+
+        // The entries of the rank just below fill the remaining room
+        usize quota = threshold > 0 ? std::min(capacity - kept, histogram[threshold - 1]) : 0;
+        const usize inMemory = kept + quota;
+
+        auto* expData = (ExpEntryEx*) malloc(std::max<usize>(inMemory, 1) * sizeof(ExpEntryEx));
+        _rootData     = (ExpEntryEx*) malloc(RootCacheSize * sizeof(ExpEntryEx));
+
+        if (!expData || !_rootData)
+        {
+            std::cerr << "info string Failed to allocate " << inMemory * sizeof(ExpEntryEx)
+                      << " bytes for experience data from file [" << fn << "]" << std::endl;
+            free(expData);
+            return false;
+        }
+
+        _expData.push_back(expData);
+        memory_track(expData, inMemory * sizeof(ExpEntryEx), MemoryTag::Experience);
+        memory_track(_rootData, RootCacheSize * sizeof(ExpEntryEx), MemoryTag::Experience);
+
+        _mainExp.resize(inMemory);
+
+        ExpEntryEx* exp = expData;
+        if (!_index.scan(_abortLoading, [&](const ExpRecord& r) {
+                const int rk = rank(r, opening);
+
+                if (rk >= threshold || (rk == threshold - 1 && quota && quota--))
+                {
+                    set_entry(exp, r);
+                    link_entry(exp++);
+                }
+            }))
+            return false;
+
+        assert(usize(exp - expData) == inMemory);
+
+        auto basename = [](const std::string& p) {
+            const auto pos = p.find_last_of("/\\");
+            return (pos == std::string::npos) ? p : p.substr(pos + 1);
+        };
+
+        sync_cout << "info string " << basename(fn) << " -> Total moves: " << _index.size()
+                  << ". In memory: " << inMemory << " moves, " << _mainExp.size()
+                  << " positions (" << opening.size() << " from the start position)"
+                  << ". On disk: " << _index.size() - inMemory << " moves" << sync_endl;
+
+        return true;
+    }
+
     bool _save(const std::string& fn, const bool saveAll) {
         std::fstream out;
         out.open(Utility::map_path(fn), std::ios::out | std::ios::binary | std::ios::app);
@@ -761,45 +1627,27 @@ class ExperienceData {
         }
         else
         {
-            // Deduplicate new entries (same key+move) within this incremental batch
-            std::unordered_set<uint64_t> seen;
-
-            // NOTE: do NOT cast e->move; read its raw bytes instead.
-            auto km_hash = [](const ExpEntryEx* e) -> uint64_t {
-                uint64_t mv = 0;
-                const size_t n = (sizeof(mv) < sizeof(e->move)) ? sizeof(mv) : sizeof(e->move);
-                std::memcpy(&mv, &e->move, n);
-                return static_cast<uint64_t>(e->key) ^ (mv * 0x9E3779B185EBCA87ULL);
-            };
+            usize pvWritten = 0;
+            const auto entries = new_exp(pvWritten);
 
-            usize pvWritten = 0, mpvWritten = 0;
-
-            for (auto* const expList : {&_newPvExp, &_newMultiPvExp})
+            for (const ExpEntryEx* exp : entries)
             {
-                for (const ExpEntryEx* exp : *expList)
+                if (!write_entry(exp, false))
                 {
-                    if (exp->depth < MinDepth)
-                        continue;
-
-                    const uint64_t sig = km_hash(exp);
-                    if (!seen.insert(sig).second)
-                        continue; // skip duplicate (same position key + move)
-
-                    if (!write_entry(exp, false))
-                    {
-                        sync_cout
-                          << "info string Failed to save experience entry to experience file ["
-                          << fn << "]" << sync_endl;
-                        return false;
-                    }
-
-                    if (expList == &_newPvExp) ++pvWritten; else ++mpvWritten;
+                    sync_cout
+                      << "info string Failed to save experience entry to experience file ["
+                      << fn << "]" << sync_endl;
+                    return false;
                 }
             }
 
             sync_cout << "info string Saved " << pvWritten << " PV and "
-                      << mpvWritten << " MultiPV entries to experience file: " << fn
+                      << entries.size() - pvWritten << " MultiPV entries to experience file: " << fn
                       << sync_endl;
+
+            if (static_cast<bool>(Options["Experience Journal"]) && !append_journal(fn, entries))
+                sync_cout << "info string Failed to write experience journal ["
+                          << journal_filename(fn) << "]" << sync_endl;
         }
 
         //Flush buffer
@@ -812,8 +1660,10 @@ class ExperienceData {
     }
 
    public:
-    ExperienceData() {
-        _loading = false;
+    explicit ExperienceData(const usize maxBytes = 0) {
+        _maxBytes = maxBytes;
+        _rootData = nullptr;
+        _loading  = false;
         _abortLoading.store(false, std::memory_order_relaxed);
         _loadingResult.store(false, std::memory_order_relaxed);
         _loaderThread = nullptr;
@@ -823,6 +1673,18 @@ class ExperienceData {
 
     [[nodiscard]] std::string filename() const { return _filename; }
 
+    [[nodiscard]] usize max_bytes() const { return _maxBytes; }
+
+    // Merges an entry of another host: appended by the caller to the file,
+    // linked here so that the data in memory matches it
+    void import_entry(const Current::ExpEntry& e) {
+        auto* exp  = new ExpEntryEx(e.key, e.move, e.value, e.depth, 1);
+        exp->count = e.count;
+
+        _oldExpData.push_back(exp);
+        link_entry(exp);
+    }
+
     [[nodiscard]] bool has_new_exp() const { return !_newPvExp.empty() || !_newMultiPvExp.empty(); }
 
     bool load(const std::string& filename, bool synchronous) {
@@ -932,17 +1794,137 @@ class ExperienceData {
         }
     }
 
+    // The entries read near the root come first: they hold the positions kept
+    // on disk only, and complete those kept in memory only in part
     [[nodiscard]] const ExpEntryEx* probe(const Key k) const {
-        ExpConstIterator itr = _mainExp.find(k);
-        if (itr == _mainExp.end())
-            return nullptr;
+        ExpConstIterator itr;
+
+        if (_rootExp.empty() || (itr = _rootExp.find(k)) == _rootExp.end())
+        {
+            itr = _mainExp.find(k);
+            if (itr == _mainExp.end())
+                return nullptr;
+        }
 
         assert(itr->second->key == k);
 
         return itr->second;
     }
 
+    // Reads from the index the entries of the positions up to RootProbePlies
+    // from 'root', or only its children when the search is timed, to keep the
+    // disk reads short once the clock runs. A position whose lower ranked
+    // moves were left on disk is read whole. Called before the search threads
+    // start, which only read them.
+    void prepare_root(const Position& root, const bool timed) {
+        if (!_index.is_open())
+            return;
+
+        _rootExp.clear();
+
+        const int              plies = timed ? 1 : RootProbePlies;
+        usize                  used  = 0;
+        std::vector<ExpRecord> records;
+        StateInfo              states[RootProbePlies + 1];
+        Position               pos;
+        pos.set(root.fen(), root.is_chess960(), &states[0]);
+
+        auto cache = [&](const ExpRecord& r) {
+            set_entry(_rootData + used, r);
+            link_entry(_rootExp, _rootData + used++);
+        };
+
+        auto visit = [&](auto&& self, const int ply) -> void {
+            const Key k = pos.key();
+
+            if (used < RootCacheSize && !_rootExp.count(k) && _index.lookup(k, records))
+            {
+                const auto        itr      = _mainExp.find(k);
+                const ExpEntryEx* inMemory = itr != _mainExp.end() ? itr->second : nullptr;
+
+                usize onDiskOnly = 0, kept = 0;
+                for (const auto& r : records)
+                    onDiskOnly += !inMemory || !inMemory->find(r.move);
+                for (const ExpEntryEx* e = inMemory; e; e = e->next)
+                    ++kept;
+
+                // A position in memory is cached with all of its moves or not at all
+                if (!inMemory)
+                    for (usize i = 0; i < records.size() && used < RootCacheSize; ++i)
+                        cache(records[i]);
+                else if (onDiskOnly && used + kept + onDiskOnly <= RootCacheSize)
+                {
+                    for (const ExpEntryEx* e = inMemory; e; e = e->next)
+                        cache(to_record(*e));
+
+                    for (const auto& r : records)
+                        if (!inMemory->find(r.move))
+                            cache(r);
+                }
+            }
+
+            if (ply == plies)
+                return;
+
+            for (const auto& m : MoveList<LEGAL>(pos))
+            {
+                pos.do_move(m, states[ply + 1], nullptr);
+                self(self, ply + 1);
+                pos.undo_move(m);
+            }
+        };
+
+        visit(visit, 0);
+    }
+
+    // A position learned near the root keeps the moves that were only on disk:
+    // they are copied to the main map before the new entry is linked there,
+    // and the position leaves the cache, which would hide the new entry
+    void promote_root_entries(const Key k) {
+        if (_rootExp.empty())
+            return;
+
+        ExpIterator itr = _rootExp.find(k);
+        if (itr == _rootExp.end())
+            return;
+
+        const auto        mainItr  = _mainExp.find(k);
+        const ExpEntryEx* inMemory = mainItr != _mainExp.end() ? mainItr->second : nullptr;
+
+        for (const ExpEntryEx* e = itr->second; e; e = e->next)
+        {
+            if (inMemory && inMemory->find(e->move))
+                continue;
+
+            auto* exp  = new ExpEntryEx(e->key, e->move, e->value, e->depth, 1);
+            exp->count = e->count;
+
+            _oldExpData.push_back(exp);
+            link_entry(exp);
+        }
+
+        _rootExp.erase(itr);
+    }
+
+    // Slot where find() starts looking for 'k', or nullptr if the layout is
+    // unknown or the map has no table yet. The dense map is one flat array
+    // probed from hash(k) onwards.
+    [[nodiscard]] const void* first_bucket(const Key k) const {
+#if defined(USE_GOOGLE_SPARSEHASH_DENSEMAP) && defined(USE_CUSTOM_HASHER)
+        const usize buckets = _mainExp.bucket_count();
+        if (!buckets)
+            return nullptr;
+
+        return _mainExp.end().pos - buckets + (KeyHasher{}(k) & (buckets - 1));
+#else
+        (void) k;
+        return nullptr;
+#endif
+    }
+
     void add_pv_experience(const Key k, const Move m, const Value v, const Depth d) {
+        promote_root_entries(k);
+
         auto* exp = new ExpEntryEx(k, m, v, d, 1);
 
         if (exp)
@@ -953,6 +1935,8 @@ class ExperienceData {
     }
 
     void add_multipv_experience(const Key k, const Move m, const Value v, const Depth d) {
+        promote_root_entries(k);
+
         auto* exp = new ExpEntryEx(k, m, v, d, 1);
 
         if (exp)
@@ -973,6 +1957,7 @@ bool            learningPaused    = false;
 // Global experience functions
 ////////////////////////////////////////////////////////////////
 
+bool              g_prefetch = false;
 std::atomic<bool> g_benchMode{false};
 std::atomic<bool> g_benchSingleShot{false};
 
@@ -1012,17 +1997,19 @@ void init() {
     }
 
     const std::string filename = Options["Experience File"];
+    const usize       maxBytes = usize(int(Options["Experience Max MB"])) * 1024 * 1024;
 
     if (currentExperience)
     {
-        if (currentExperience->filename() == filename && currentExperience->loading_result())
+        if (currentExperience->filename() == filename && currentExperience->loading_result()
+            && currentExperience->max_bytes() == maxBytes)
             return;
 
 
         unload();
     }
 
-    currentExperience = new ExperienceData();
+    currentExperience = new ExperienceData(maxBytes);
     currentExperience->load(filename, false);
 }
 
@@ -1036,6 +2023,7 @@ void unload() {
 }
 
 void save() {
+    TRACE_SCOPE("experience_save");
     if (!currentExperience || !currentExperience->has_new_exp()
         || static_cast<bool>(Options["Experience Readonly"]))
         return;
@@ -1051,6 +2039,17 @@ const ExpEntryEx* probe(const Key k) {
     return currentExperience->probe(k);
 }
 
+void prepare_root(const Position& pos, const bool timed) {
+    if (experienceEnabled && currentExperience)
+        currentExperience->prepare_root(pos, timed);
+}
+
+void prefetch(const Key k) {
+    if (experienceEnabled && currentExperience)
+        if (const void* addr = currentExperience->first_bucket(k))
+            Hypnos::prefetch(addr);
+}
+
 const ExpEntryEx* find_best_entry(const Key k) {
     const ExpEntryEx* bestEntry    = nullptr;
     const ExpEntryEx* currentEntry = probe(k);
@@ -1161,6 +2160,233 @@ void merge(const int argc, char* argv[]) {
     exp.save(targetFilename, true, false);
 }
 
+// Export journal command:
+// Format:  export_journal <delta file>
+// Example: export_journal /sync/host1.delta
+// Note:    Moves the entries learned since the previous export to <delta file>, appending
+//          them when it already exists. The entries are recorded when they are saved to
+//          the experience file while the "Experience Journal" option is enabled
+void export_journal(const int argc, char* argv[]) {
+    wait_for_loading_finished();
+
+    if (argc != 1)
+    {
+        sync_cout << "info string Syntax: export_journal <delta file>" << sync_endl;
+        return;
+    }
+
+    if (!currentExperience)
+    {
+        sync_cout << "info string Experience is not loaded" << sync_endl;
+        return;
+    }
+
+    const std::string deltaFilename = Utility::map_path(Utility::unquote(argv[0]));
+    const std::string filename      = currentExperience->filename();
+    const std::string journal       = journal_filename(filename);
+
+    // Save, and so journal, the entries learned so far
+    save();
+
+    std::error_code ec;
+    const usize     sigLength   = strlen(JournalSignature);
+    const usize     journalSize = Utility::file_exists(journal)
+                                  ? usize(std::filesystem::file_size(journal, ec))
+                                  : 0;
+    const usize     count       = journalSize > sigLength ? (journalSize - sigLength) / JournalRecordSize : 0;
+
+    if (!count && !static_cast<bool>(Options["Experience Journal"]))
+        sync_cout << "info string Enable \"Experience Journal\" to record the learned entries"
+                  << sync_endl;
+
+    // A new delta file is the journal itself
+    if (!Utility::file_exists(deltaFilename) && count)
+    {
+        std::filesystem::rename(journal, deltaFilename, ec);
+
+        if (!ec)
+        {
+            sync_cout << "info string Exported " << count << " experience entries to "
+                      << deltaFilename << sync_endl;
+            return;
+        }
+    }
+
+    // Otherwise the records are appended to it
+    std::ofstream out(deltaFilename, std::ios::out | std::ios::binary | std::ios::app);
+
+    if (!out.is_open())
+    {
+        sync_cout << "info string Could not open delta file: " << deltaFilename << sync_endl;
+        return;
+    }
+
+    if (out.tellp() == 0)
+        out << JournalSignature;
+
+    if (count)
+    {
+        std::ifstream     in(journal, std::ios::in | std::ios::binary);
+        std::vector<char> buffer(WriteBufferSize);
+
+        in.seekg(sigLength);
+
+        for (usize left = count * JournalRecordSize; left && in;)
+        {
+            in.read(buffer.data(), std::min(left, buffer.size()));
+            out.write(buffer.data(), in.gcount());
+            left -= usize(in.gcount());
+        }
+
+        out.close();
+
+        if (!in || !out)
+        {
+            sync_cout << "info string Failed to export the experience journal to "
+                      << deltaFilename << sync_endl;
+            return;
+        }
+
+        in.close();
+        std::remove(journal.c_str());
+    }
+
+    sync_cout << "info string Exported " << count << " experience entries to " << deltaFilename
+              << sync_endl;
+}
+
+// Import journal command:
+// Format:  import_journal <delta file> [target.exp]
+// Example: import_journal /sync/host1.delta
+// Note:    The entries are appended to the target experience file, where loading merges
+//          them like the 'merge' command does, so the cost depends on the delta only.
+//          When the target is the loaded experience file they are merged in memory too,
+//          which needs the search to be finished. A delta is imported once: when it was
+//          exported to again since, only the records added by then are imported
+void import_journal(const int argc, char* argv[]) {
+    wait_for_loading_finished();
+
+    if (argc < 1 || argc > 2)
+    {
+        sync_cout << "info string Syntax: import_journal <delta file> [target.exp]" << sync_endl;
+        return;
+    }
+
+    const std::string deltaFilename  = Utility::map_path(Utility::unquote(argv[0]));
+    const std::string targetFilename = Utility::map_path(
+      argc == 2 ? Utility::unquote(argv[1]) : std::string(Options["Experience File"]));
+
+    std::ifstream in(deltaFilename, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if (!in.is_open())
+    {
+        sync_cout << "info string Could not open delta file: " << deltaFilename << sync_endl;
+        return;
+    }
+
+    // Check the signature and the length of the data
+    const usize sigLength = strlen(JournalSignature);
+    const usize inSize    = in.tellg();
+    std::string signature(sigLength, '\0');
+
+    in.seekg(0);
+    in.read(signature.data(), sigLength);
+
+    if (!in || signature != JournalSignature || (inSize - sigLength) % JournalRecordSize)
+    {
+        sync_cout << "info string The file [" << deltaFilename << "] is not a valid experience delta"
+                  << sync_endl;
+        return;
+    }
+
+    // Skip the records imported before
+    const usize   count = (inSize - sigLength) / JournalRecordSize;
+    std::uint64_t digest;
+    const usize   skip = imported_records(targetFilename, in, count, digest);
+
+    if (count && skip == count)
+    {
+        sync_cout << "info string The delta [" << deltaFilename << "] is already imported into "
+                  << targetFilename << sync_endl;
+        return;
+    }
+
+    in.clear();
+    in.seekg(sigLength + skip * JournalRecordSize);
+
+    std::fstream out(targetFilename, std::ios::out | std::ios::binary | std::ios::app);
+
+    if (!out.is_open())
+    {
+        sync_cout << "info string Failed to open experience file [" << targetFilename
+                  << "] for writing" << sync_endl;
+        return;
+    }
+
+    out.seekp(0, std::ios::end);
+    if (out.tellp() == 0)
+        out << Current::ExperienceSignature;
+
+    ExperienceData* loaded = currentExperience
+                                 && Utility::map_path(currentExperience->filename()) == targetFilename
+                               ? currentExperience
+                               : nullptr;
+
+    // Stream the records in chunks
+    std::vector<char> records(4096 * JournalRecordSize);
+    std::vector<char> entries;
+    Current::ExpEntry entry(ExpKey{0}, ExpMove::none(), (ExpValue) 0, (ExpDepth) 0, 0);
+
+    for (usize done = skip; done < count;)
+    {
+        const usize n = std::min<usize>(4096, count - done);
+
+        if (!in.read(records.data(), n * JournalRecordSize))
+            break;
+
+        entries.clear();
+
+        for (usize i = 0; i < n; ++i)
+        {
+            unpack_journal_record(records.data() + i * JournalRecordSize, entry);
+
+            const char* data = reinterpret_cast<const char*>(&entry);
+            entries.insert(entries.end(), data, data + sizeof(Current::ExpEntry));
+
+            if (loaded)
+                loaded->import_entry(entry);
+        }
+
+        out.write(entries.data(), entries.size());
+        done += n;
+    }
+
+    if (!in || !out)
+    {
+        sync_cout << "info string Failed to import experience delta [" << deltaFilename << "]"
+                  << sync_endl;
+        return;
+    }
+
+    out.close();
+
+    std::ofstream log;
+
+    if (count)
+    {
+        log.open(imported_filename(targetFilename), std::ios::out | std::ios::app);
+        log << count << ' ' << digest << '\n';
+    }
+
+    if (count && !log)
+        sync_cout << "info string Failed to record the import of [" << deltaFilename << "] in "
+                  << imported_filename(targetFilename) << sync_endl;
+
+    sync_cout << "info string Imported " << count - skip << " experience entries into "
+              << targetFilename << (loaded ? " (merged in memory)" : "")
+              << (skip ? ", " + std::to_string(skip) + " were imported before" : "") << sync_endl;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Convert compact PGN data to experience entries
 //
@@ -1648,6 +2874,7 @@ void convert_compact_pgn(const int argc, char* argv[]) {
 void show_exp(Position& pos, const bool extended) {
     // Assicura che il caricamento sia terminato
     wait_for_loading_finished();
+    prepare_root(pos);
 
     sync_cout << pos << std::endl;
 
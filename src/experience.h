@@ -219,6 +219,12 @@ void save();
 void wait_for_loading_finished();
 
 const ExpEntryEx* probe(ExpKey k);
+// Reads the entries near the root kept on disk by "Experience Max MB", only
+// those of the root and its children when 'timed'
+void prepare_root(const Hypnos::Position& pos, bool timed = false);
+// Called by do_move() next to the TT prefetch when g_prefetch is set, the
+// probe in search() follows
+void prefetch(ExpKey k);
 const ExpEntryEx* find_best_entry(ExpKey k);
 
 void defrag(int argc, char* argv[]);
@@ -226,6 +232,9 @@ void merge(int argc, char* argv[]);
 void show_exp(Hypnos::Position& pos, bool extended);
 void convert_compact_pgn(int argc, char* argv[]);
 
+void export_journal(int argc, char* argv[]);
+void import_journal(int argc, char* argv[]);
+
 void import_cpgn(int argc, char* argv[]);
 void import_pgn (int argc, char* argv[]);
 void cpgn_to_exp(int argc, char* argv[]);
@@ -238,6 +247,10 @@ bool is_learning_paused();
 void add_pv_experience(ExpKey k, ExpMove m, ExpValue v, ExpDepth d);
 void add_multipv_experience(ExpKey k, ExpMove m, ExpValue v, ExpDepth d);
 
+// Set by "Experience Prefetch". Off by default: it only pays off with a large
+// file, see the "do_move+Experience::probe" kernel of the microbench
+extern bool g_prefetch;
+
 // Bench mode: create file but do not write entries during the bench
 extern std::atomic<bool> g_benchMode;
 
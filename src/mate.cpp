@@ -0,0 +1,301 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "mate.h"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+#include "movegen.h"
+#include "position.h"
+
+namespace Hypnos::Mate {
+
+namespace {
+
+constexpr std::uint32_t Infinite = 1 << 30;
+
+// A position is proven or disproven for a given number of remaining plies,
+// so both go into the table key
+Key node_key(Key posKey, int depth) { return posKey ^ (Key(depth + 1) * 0x9E3779B97F4A7C15ULL); }
+
+std::uint32_t saturated_add(std::uint32_t a, std::uint32_t b) {
+    return std::uint32_t(std::min<std::uint64_t>(Infinite, std::uint64_t(a) + b));
+}
+
+bool solved(std::uint32_t phi, std::uint32_t delta) { return phi == 0 || delta == 0; }
+
+bool is_mate(Position& pos) { return pos.checkers() && !MoveList<LEGAL>(pos).size(); }
+
+}  // namespace
+
+void Solver::resize(std::size_t mbSize) {
+    if (mbSize == tableMb && table)
+        return;
+
+    // A power of two number of entries, grouped in buckets of two
+    entryCount = 2;
+    while (entryCount * 2 * sizeof(Entry) <= mbSize * 1024 * 1024)
+        entryCount *= 2;
+
+    table.reset();
+
+    MemoryTagScope memoryTag(MemoryTag::Other);
+    table   = make_unique_large_page<Entry[]>(entryCount);
+    tableMb = mbSize;
+}
+
+bool Solver::lookup(Key key, std::uint32_t& phi, std::uint32_t& delta) const {
+    const Entry* bucket = &table[key & (entryCount - 2)];
+
+    for (int i = 0; i < 2; ++i)
+        if (bucket[i].key == key)
+        {
+            phi   = bucket[i].phi;
+            delta = bucket[i].delta;
+            return true;
+        }
+
+    return false;
+}
+
+// Solved entries are only replaced when both entries of the bucket are solved
+void Solver::store(Key key, std::uint32_t phi, std::uint32_t delta) {
+    Entry* bucket  = &table[key & (entryCount - 2)];
+    Entry* replace = &bucket[0];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (bucket[i].key == key || !bucket[i].key)
+        {
+            replace = &bucket[i];
+            break;
+        }
+
+        if (!solved(bucket[i].phi, bucket[i].delta))
+            replace = &bucket[i];
+    }
+
+    *replace = {key, phi, delta};
+}
+
+// Fills the children of the node at 'ply'. Returns true when the side to
+// move is already known to win: a mate in one on the attacker's last move, or
+// a defender move that draws by repetition or the 50-move rule.
+bool Solver::expand(Position& pos, int depth, int ply) {
+    const bool attacker = ply % 2 == 0;
+    auto&      children = plyChildren[ply];
+
+    children.clear();
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        if (ply == 0 && !rootList->empty()
+            && std::find(rootList->begin(), rootList->end(), m) == rootList->end())
+            continue;
+
+        // Only a check can mate, and the defender has no time left to escape
+        if (attacker && depth == 1 && !pos.gives_check(m))
+            continue;
+
+        StateInfo st;
+        pos.do_move(m, st);
+
+        const bool mate = attacker && depth == 1 && is_mate(pos);
+        const bool draw = !mate && pos.is_draw(ply + 1);
+        const Key  key  = node_key(pos.key(), depth - 1);
+
+        pos.undo_move(m);
+
+        if (mate || (!attacker && draw))
+            return true;
+
+        // A drawing or non-mating attacker move is a lost child, which adds
+        // nothing to the proof numbers of the node
+        if (!draw && !(attacker && depth == 1))
+            children.push_back({m, key});
+    }
+
+    return false;
+}
+
+void Solver::mid(Position& pos, std::uint32_t thPhi, std::uint32_t thDelta, int depth, int ply) {
+    if (++nodes >= nodeLimit || ((nodes & 1023) == 0 && (*stopCheck)()))
+        stopped = true;
+
+    if (stopped)
+        return;
+
+    const Key key = node_key(pos.key(), depth);
+
+    if (expand(pos, depth, ply))
+    {
+        store(key, 0, Infinite);
+        return;
+    }
+
+    const auto& children = plyChildren[ply];
+
+    // The attacker has no useful move, or the defender is mated or stalemated
+    if (children.empty())
+    {
+        const bool win = ply % 2 == 1 && !pos.checkers();
+        store(key, win ? 0 : Infinite, win ? Infinite : 0);
+        return;
+    }
+
+    while (true)
+    {
+        // The phi of a node is the smallest delta of its children, and its
+        // delta the sum of their phi. Unvisited children count as (1, 1).
+        std::uint32_t phi = Infinite, delta = 0, secondDelta = Infinite, bestPhi = 0;
+        std::size_t   best = 0;
+
+        for (std::size_t i = 0; i < children.size(); ++i)
+        {
+            std::uint32_t childPhi = 1, childDelta = 1;
+            lookup(children[i].key, childPhi, childDelta);
+
+            delta = saturated_add(delta, childPhi);
+
+            if (childDelta < phi)
+            {
+                secondDelta = phi;
+                phi         = childDelta;
+                bestPhi     = childPhi;
+                best        = i;
+            }
+            else if (childDelta < secondDelta)
+                secondDelta = childDelta;
+        }
+
+        if (phi >= thPhi || delta >= thDelta || stopped)
+        {
+            store(key, phi, delta);
+            return;
+        }
+
+        // Search the most promising child until it is no longer the best one
+        // or the thresholds of this node are exceeded
+        const std::uint32_t childThPhi = saturated_add(thDelta - delta, bestPhi);
+        const std::uint32_t childThDelta =
+          std::min(thPhi, saturated_add(secondDelta, 1));
+        const Move m = children[best].move;
+
+        StateInfo st;
+        pos.do_move(m, st);
+        mid(pos, childThPhi, childThDelta, depth - 1, ply + 1);
+        pos.undo_move(m);
+    }
+}
+
+// Smallest number of remaining plies for which the table proves a mate from
+// this position, or -1 if there is none
+int Solver::proven_depth(Key posKey, int maxDepth, bool attacker) const {
+    for (int depth = attacker ? 1 : 2; depth <= maxDepth; depth += 2)
+    {
+        std::uint32_t phi, delta;
+        if (lookup(node_key(posKey, depth), phi, delta) && (attacker ? phi : delta) == 0)
+            return depth;
+    }
+
+    return -1;
+}
+
+// Follows the proof: the attacker picks the quickest mate, the defender the
+// reply that delays it the most
+void Solver::extract_pv(Position& pos, int depth, int ply, std::vector<Move>& pv) const {
+    const bool attacker  = ply % 2 == 0;
+    Move       best      = Move::none();
+    int        bestDepth = attacker ? INT_MAX : -1;
+
+    if (depth <= 0)
+        return;
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        if (ply == 0 && !rootList->empty()
+            && std::find(rootList->begin(), rootList->end(), m) == rootList->end())
+            continue;
+
+        StateInfo st;
+        pos.do_move(m, st);
+
+        int d = is_mate(pos) ? 0
+              : pos.is_draw(ply + 1) ? -1
+                                     : proven_depth(pos.key(), depth - 1, !attacker);
+
+        pos.undo_move(m);
+
+        if (attacker ? d >= 0 && d < bestDepth : (d < 0 ? depth - 1 : d) > bestDepth)
+        {
+            best      = m;
+            bestDepth = d < 0 ? depth - 1 : d;
+        }
+    }
+
+    if (best == Move::none())
+        return;
+
+    StateInfo st;
+    pv.push_back(best);
+    pos.do_move(best, st);
+    extract_pv(pos, bestDepth, ply + 1, pv);
+    pos.undo_move(best);
+}
+
+Solver::Result Solver::solve(Position&                    pos,
+                             const std::vector<Move>&     rootMoves,
+                             int                          maxMoves,
+                             std::uint64_t                maxNodes,
+                             const std::function<bool()>& stop) {
+    assert(table);
+
+    Result result;
+
+    rootList  = &rootMoves;
+    stopCheck = &stop;
+    nodes     = 0;
+    nodeLimit = maxNodes;
+    stopped   = false;
+    plyChildren.resize(2 * maxMoves);
+
+    for (int moves = 1; moves <= maxMoves && !stopped; ++moves)
+    {
+        const int depth = 2 * moves - 1;
+
+        mid(pos, Infinite, Infinite, depth, 0);
+
+        std::uint32_t phi, delta;
+        if (lookup(node_key(pos.key(), depth), phi, delta) && phi == 0)
+        {
+            extract_pv(pos, depth, 0, result.pv);
+
+            if (!result.pv.empty())
+                result.mateIn = moves;
+            break;
+        }
+    }
+
+    result.nodes = nodes;
+    return result;
+}
+
+}  // namespace Hypnos::Mate
@@ -0,0 +1,96 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MATE_H_INCLUDED
+#define MATE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "memory.h"
+#include "types.h"
+
+namespace Hypnos {
+
+class Position;
+
+namespace Mate {
+
+// Depth-first proof-number search (df-pn) for "go mate N", with its own table.
+// Every node keeps a pair (phi, delta): its proof and disproof numbers seen
+// from the side to move. phi == 0 means the side to move wins, i.e. the
+// attacker mates within the remaining plies or the defender escapes.
+class Solver {
+   public:
+    struct Result {
+        int               mateIn = 0;  // Moves to mate, 0 when nothing was proven
+        std::vector<Move> pv;
+        std::uint64_t     nodes = 0;
+    };
+
+    void resize(std::size_t mbSize);
+
+    // Looks for the shortest mate in at most 'maxMoves' moves, by proving mate
+    // in 1, 2, ... moves in turn. Only 'rootMoves' are tried at the root. The
+    // search gives up after 'maxNodes' nodes or once 'stop' returns true.
+    Result solve(Position&                    pos,
+                 const std::vector<Move>&     rootMoves,
+                 int                          maxMoves,
+                 std::uint64_t                maxNodes,
+                 const std::function<bool()>& stop);
+
+   private:
+    struct Entry {
+        Key           key;
+        std::uint32_t phi, delta;
+    };
+
+    struct Child {
+        Move move;
+        Key  key;
+    };
+
+    void mid(Position& pos, std::uint32_t thPhi, std::uint32_t thDelta, int depth, int ply);
+    bool expand(Position& pos, int depth, int ply);
+    bool lookup(Key key, std::uint32_t& phi, std::uint32_t& delta) const;
+    void store(Key key, std::uint32_t phi, std::uint32_t delta);
+    int  proven_depth(Key posKey, int maxDepth, bool attacker) const;
+    void extract_pv(Position& pos, int depth, int ply, std::vector<Move>& pv) const;
+
+    LargePagePtr<Entry[]> table;
+    std::size_t           entryCount = 0;
+    std::size_t           tableMb    = 0;
+
+    // The children of the nodes on the current path, by ply
+    std::vector<std::vector<Child>> plyChildren;
+
+    const std::vector<Move>*     rootList  = nullptr;
+    const std::function<bool()>* stopCheck = nullptr;
+    std::uint64_t                nodes     = 0;
+    std::uint64_t                nodeLimit = 0;
+    bool                         stopped   = false;
+};
+
+}  // namespace Mate
+
+}  // namespace Hypnos
+
+#endif  // #ifndef MATE_H_INCLUDED
@@ -18,7 +18,15 @@
 
 #include "memory.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 
 #if __has_include("features.h")
     #include <features.h>
@@ -119,6 +127,9 @@ void* aligned_large_pages_alloc(size_t allocSize) {
     if (!mem)
         mem = VirtualAlloc(nullptr, allocSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 
+    if (mem)
+        memory_track(mem, allocSize);
+
     return mem;
 }
 
@@ -138,6 +149,10 @@ void* aligned_large_pages_alloc(size_t allocSize) {
     #if defined(MADV_HUGEPAGE)
     madvise(mem, size, MADV_HUGEPAGE);
     #endif
+
+    if (mem)
+        memory_track(mem, size);
+
     return mem;
 }
 
@@ -182,6 +197,8 @@ bool has_large_pages() {
 
 void aligned_large_pages_free(void* mem) {
 
+    memory_untrack(mem);
+
     if (mem && !VirtualFree(mem, 0, MEM_RELEASE))
     {
         DWORD err = GetLastError();
@@ -193,7 +210,227 @@ void aligned_large_pages_free(void* mem) {
 
 #else
 
-void aligned_large_pages_free(void* mem) { std_aligned_free(mem); }
+void aligned_large_pages_free(void* mem) {
+    memory_untrack(mem);
+    std_aligned_free(mem);
+}
+
+#endif
+
+
+namespace {
+
+struct TrackedRegion {
+    size_t    size;
+    MemoryTag tag;
+};
+
+struct MemoryRegistry {
+    std::mutex                                       mutex;
+    std::unordered_map<const void*, TrackedRegion> regions;
+};
+
+// Function-local static, so that allocations made during static
+// initialization of other translation units are safe.
+MemoryRegistry& registry() {
+    static MemoryRegistry r;
+    return r;
+}
+
+thread_local MemoryTag currentTag = MemoryTag::Other;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+// One virtual memory area of the process as described by the kernel
+struct Mapping {
+    uintptr_t           start = 0, end = 0;
+    size_t              rss = 0, huge = 0, shared = 0;
+    size_t              kernelPageKB = 4;
+    std::vector<size_t> nodes;
+};
+
+bool parse_range(const std::string& line, uintptr_t& start, uintptr_t& end) {
+    // Headers look like "7f12a4000000-7f12a6000000 rw-p ...", field lines
+    // like "Rss:   1024 kB" always start with an uppercase letter.
+    if (line.empty() || !std::isxdigit(static_cast<unsigned char>(line[0]))
+        || std::isupper(static_cast<unsigned char>(line[0])))
+        return false;
+
+    size_t dash = line.find('-');
+    size_t sp   = line.find(' ');
+    if (dash == std::string::npos || sp == std::string::npos || dash > sp)
+        return false;
+
+    start = std::stoull(line.substr(0, dash), nullptr, 16);
+    end   = std::stoull(line.substr(dash + 1, sp - dash - 1), nullptr, 16);
+    return true;
+}
+
+std::vector<Mapping> read_mappings() {
+    std::vector<Mapping> maps;
+    std::ifstream        smaps("/proc/self/smaps");
+    std::string          line, key;
+
+    while (std::getline(smaps, line))
+    {
+        uintptr_t start, end;
+        if (parse_range(line, start, end))
+        {
+            maps.emplace_back();
+            maps.back().start = start;
+            maps.back().end   = end;
+            continue;
+        }
+
+        if (maps.empty())
+            continue;
+
+        std::istringstream is(line);
+        size_t             kb = 0;
+        is >> key >> kb;
+
+        Mapping& m = maps.back();
+        if (key == "Rss:")
+            m.rss = kb * 1024;
+        else if (key == "AnonHugePages:" || key == "ShmemPmdMapped:" || key == "FilePmdMapped:")
+            m.huge += kb * 1024;
+        else if (key == "Shared_Clean:" || key == "Shared_Dirty:")
+            m.shared += kb * 1024;
+        else if (key == "KernelPageSize:")
+            m.kernelPageKB = kb;
+    }
+
+    // hugetlbfs mappings do not report AnonHugePages
+    for (Mapping& m : maps)
+        if (m.kernelPageKB > 4)
+            m.huge = m.rss;
+
+    // numa_maps lists the same areas with "N<node>=<pages>" tokens
+    std::ifstream numaMaps("/proc/self/numa_maps");
+    while (std::getline(numaMaps, line))
+    {
+        std::istringstream is(line);
+        std::string        token;
+        uintptr_t          start = 0;
+        std::vector<std::pair<size_t, size_t>> pages;
+        size_t                                 pageKB = 4;
+
+        is >> std::hex >> start >> std::dec;
+        while (is >> token)
+        {
+            if (token.size() > 2 && token[0] == 'N' && std::isdigit(token[1]))
+            {
+                size_t eq = token.find('=');
+                if (eq != std::string::npos)
+                    pages.emplace_back(std::stoull(token.substr(1, eq - 1)),
+                                       std::stoull(token.substr(eq + 1)));
+            }
+            else if (token.rfind("kernelpagesize_kB=", 0) == 0)
+                pageKB = std::stoull(token.substr(18));
+        }
+
+        auto it = std::lower_bound(maps.begin(), maps.end(), start,
+                                   [](const Mapping& m, uintptr_t s) { return m.start < s; });
+        if (it == maps.end() || it->start != start)
+            continue;
+
+        for (const auto& [node, count] : pages)
+        {
+            if (it->nodes.size() <= node)
+                it->nodes.resize(node + 1);
+            it->nodes[node] += count * pageKB * 1024;
+        }
+    }
+
+    return maps;
+}
 
 #endif
+
+}  // namespace
+
+const char* to_string(MemoryTag tag) {
+    constexpr const char* Names[] = {"Other",      "TT",   "Worker", "Network",
+                                     "Experience", "Book", "Syzygy"};
+    static_assert(std::size(Names) == size_t(MemoryTag::TAG_NB));
+
+    return Names[size_t(tag)];
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) :
+    previous(currentTag) {
+    currentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() { currentTag = previous; }
+
+void memory_track(const void* ptr, size_t size, MemoryTag tag) {
+    if (!ptr)
+        return;
+
+    MemoryRegistry&             r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    r.regions[ptr] = {size, tag};
+}
+
+void memory_track(const void* ptr, size_t size) { memory_track(ptr, size, currentTag); }
+
+void memory_untrack(const void* ptr) {
+    if (!ptr)
+        return;
+
+    MemoryRegistry&             r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    r.regions.erase(ptr);
+}
+
+std::vector<MemoryUsage> memory_usage() {
+    std::vector<MemoryUsage> usage(size_t(MemoryTag::TAG_NB));
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    const std::vector<Mapping> maps = read_mappings();
+#endif
+
+    MemoryRegistry&             r = registry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+
+    for (const auto& [ptr, region] : r.regions)
+    {
+        MemoryUsage& u = usage[size_t(region.tag)];
+        u.regions++;
+        u.bytes += region.size;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+        // Attribute each overlapping area proportionally to the overlap
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+        const uintptr_t end   = begin + region.size;
+
+        auto it = std::upper_bound(maps.begin(), maps.end(), begin,
+                                   [](uintptr_t b, const Mapping& m) { return b < m.start; });
+        if (it != maps.begin())
+            --it;
+
+        for (; it != maps.end() && it->start < end; ++it)
+        {
+            const uintptr_t lo = std::max(begin, it->start);
+            const uintptr_t hi = std::min(end, it->end);
+            if (lo >= hi)
+                continue;
+
+            const double f = double(hi - lo) / double(it->end - it->start);
+            u.resident += size_t(f * it->rss);
+            u.huge += size_t(f * it->huge);
+            u.shared += size_t(f * it->shared);
+
+            if (u.nodes.size() < it->nodes.size())
+                u.nodes.resize(it->nodes.size());
+            for (size_t n = 0; n < it->nodes.size(); ++n)
+                u.nodes[n] += size_t(f * it->nodes[n]);
+        }
+#endif
+    }
+
+    return usage;
+}
+
 }  // namespace Hypnos
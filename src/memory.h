@@ -26,6 +26,7 @@
 #include <new>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "types.h"
 
@@ -70,6 +71,52 @@ void  aligned_large_pages_free(void* mem);
 
 bool has_large_pages();
 
+// Memory accounting. Every region returned by aligned_large_pages_alloc() is
+// attributed to the tag of the innermost MemoryTagScope active on the calling
+// thread. Allocations that bypass it (malloc'ed experience and book data, file
+// and shared memory mappings) are registered explicitly with memory_track().
+enum class MemoryTag : std::uint8_t {
+    Other,
+    TT,
+    Worker,
+    Network,
+    Experience,
+    Book,
+    Syzygy,
+    TAG_NB
+};
+
+const char* to_string(MemoryTag tag);
+
+class MemoryTagScope {
+   public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+    MemoryTagScope(const MemoryTagScope&)            = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+   private:
+    MemoryTag previous;
+};
+
+void memory_track(const void* ptr, size_t size, MemoryTag tag);
+void memory_track(const void* ptr, size_t size);  // Uses the current tag
+void memory_untrack(const void* ptr);
+
+struct MemoryUsage {
+    size_t              regions  = 0;
+    size_t              bytes    = 0;  // Reserved virtual memory
+    size_t              resident = 0;  // Backed by physical pages (0 if unknown)
+    size_t              huge     = 0;  // Resident bytes on huge pages
+    size_t              shared   = 0;  // Resident bytes in shared mappings
+    std::vector<size_t> nodes;         // Resident bytes per NUMA node
+};
+
+// Usage per tag. Residency, page size and NUMA placement are only available
+// on Linux, where they are read from /proc/self/smaps and /proc/self/numa_maps.
+std::vector<MemoryUsage> memory_usage();
+
 // Frees memory which was placed there with placement new.
 // Works for both single objects and arrays of unknown bound.
 template<typename T, typename FREE_FUNC>
@@ -0,0 +1,584 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Microbenchmark harness for the hot kernels of the engine. Built with
+// 'make microbench', it links all engine objects except main.o and reports
+// the cost of each kernel in ns/op over the positions used by 'bench'.
+// Every kernel is run several times and the fastest run is kept, which
+// filters out most of the noise caused by the rest of the system.
+//
+// Usage: <engine>-microbench [reps N] [filter <substring>] [book <file>] [exp <file>]
+//                   [syzygy <path>] [save <file>] [baseline <file>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitboard.h"
+#include "engine.h"
+#include "experience.h"
+#include "misc.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "nnue/features/full_threats.h"
+#include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
+#include "polybook.h"
+#include "position.h"
+#include "search.h"
+#include "syzygy/tbprobe.h"
+#include "thread.h"
+#include "tt.h"
+#include "types.h"
+
+#if defined(HYP_FIXED_ZOBRIST)
+namespace Hypnos::HypnosZobrist {
+void SetHypnosZobrist();
+}
+#endif
+
+namespace Hypnos::Microbench {
+
+namespace {
+
+// A few positions with at most 6 pieces for the tablebase probe
+const std::vector<std::string> EndgameFens = {
+  "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",      "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+  "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",     "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+  "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",     "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+  "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",  "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1"};
+
+struct Config {
+    int         reps = 5;
+    std::string filter, book, exp, syzygy, save, baseline;
+};
+
+struct Sample {
+    std::string name;
+    double      nsPerOp;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the compiler from optimizing away the measured work
+volatile std::uint64_t Sink;
+
+// Runs 'body', which returns the number of operations it performed, once to
+// warm up caches and branch predictors and then 'reps' times, returning the
+// fastest ns/op.
+template<typename Body>
+double measure(int reps, Body&& body) {
+    Sink = Sink + body();
+
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < reps; ++r)
+    {
+        const auto          start = Clock::now();
+        const std::uint64_t ops   = body();
+        const auto          end   = Clock::now();
+
+        if (ops)
+            best = std::min(best,
+                            std::chrono::duration<double, std::nano>(end - start).count() / ops);
+    }
+    return best;
+}
+
+}  // namespace
+
+class Runner {
+   public:
+    Runner(Engine& e, const Config& c) :
+        engine(e),
+        cfg(c) {}
+
+    std::vector<Sample> run();
+
+   private:
+    struct Corpus {
+        std::string       fen;
+        bool              chess960;
+        std::vector<Move> legal;
+    };
+
+    bool selected(const std::string& name) const {
+        return cfg.filter.empty() || name.find(cfg.filter) != std::string::npos;
+    }
+
+    void add(const std::string& name, double ns) { samples.push_back({name, ns}); }
+
+    void load_corpus();
+    void bench_movegen();
+    void bench_tt();
+    void bench_books();
+    void bench_nnue();
+
+    Engine&             engine;
+    const Config&       cfg;
+    std::vector<Corpus> corpus;
+    std::vector<Key>    childKeys;
+    std::vector<Sample> samples;
+};
+
+void Runner::load_corpus() {
+    std::istringstream       noArgs;
+    std::vector<std::string> list = Benchmark::setup_bench(engine.fen(), noArgs);
+    bool                     chess960 = false;
+
+    for (const std::string& cmd : list)
+    {
+        if (cmd.find("UCI_Chess960") != std::string::npos)
+            chess960 = cmd.find("true") != std::string::npos;
+
+        if (cmd.rfind("position fen ", 0) != 0)
+            continue;
+
+        Corpus    c{cmd.substr(13), chess960, {}};
+        StateInfo st, childSt;
+        Position  pos;
+        pos.set(c.fen, chess960, &st);
+
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            c.legal.push_back(m);
+            pos.do_move(m, childSt, nullptr);
+            childKeys.push_back(pos.key());
+            pos.undo_move(m);
+        }
+        corpus.push_back(std::move(c));
+    }
+}
+
+void Runner::bench_movegen() {
+    // Each kernel sets up its positions once, outside of the timed region
+    std::vector<std::unique_ptr<Position>> positions;
+    std::vector<StateInfo>                 roots(corpus.size());
+
+    for (size_t i = 0; i < corpus.size(); ++i)
+    {
+        positions.push_back(std::make_unique<Position>());
+        positions.back()->set(corpus[i].fen, corpus[i].chess960, &roots[i]);
+    }
+
+    auto stack = std::make_unique<Eval::NNUE::AccumulatorStack>();
+
+    if (selected("do_move/undo_move"))
+        add("do_move/undo_move", measure(cfg.reps, [&]() {
+                StateInfo     st;
+                std::uint64_t ops = 0;
+
+                for (size_t i = 0; i < corpus.size(); ++i)
+                    for (Move m : corpus[i].legal)
+                    {
+                        Position& pos             = *positions[i];
+                        auto [dirtyPiece, threats] = stack->push();
+                        pos.do_move(m, st, pos.gives_check(m), dirtyPiece, threats, &engine.tt);
+                        pos.undo_move(m);
+                        stack->pop();
+                        ++ops;
+                    }
+                return ops;
+            }));
+
+    if (selected("MoveList<LEGAL>"))
+        add("MoveList<LEGAL>", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0, moves = 0;
+                for (int k = 0; k < 20; ++k)
+                    for (auto& pos : positions)
+                    {
+                        moves += MoveList<LEGAL>(*pos).size();
+                        ++ops;
+                    }
+                Sink = Sink + moves;
+                return ops;
+            }));
+
+    if (selected("MovePicker"))
+    {
+        const Search::Worker& w       = *engine.threads.main_thread()->worker;
+        const PieceToHistory* contHist[] = {
+          &w.continuationHistory[0][0][NO_PIECE][0], &w.continuationHistory[0][0][NO_PIECE][0],
+          &w.continuationHistory[0][0][NO_PIECE][0], &w.continuationHistory[0][0][NO_PIECE][0],
+          &w.continuationHistory[0][0][NO_PIECE][0], &w.continuationHistory[0][0][NO_PIECE][0]};
+
+        // One op is one move returned by next_move() in a main search picker
+        add("MovePicker (per move)", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0;
+                for (int k = 0; k < 10; ++k)
+                    for (auto& pos : positions)
+                    {
+                        MovePicker mp(*pos, Move::none(), 10, &w.mainHistory, &w.lowPlyHistory,
+                                      &w.captureHistory, contHist, &w.pawnHistory, 0);
+                        while (mp.next_move())
+                            ++ops;
+                    }
+                return ops;
+            }));
+    }
+
+    if (selected("see_ge"))
+        add("see_ge", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0, positive = 0;
+                for (int k = 0; k < 10; ++k)
+                    for (size_t i = 0; i < corpus.size(); ++i)
+                        for (Move m : corpus[i].legal)
+                        {
+                            positive += positions[i]->see_ge(m, 0);
+                            ++ops;
+                        }
+                Sink = Sink + positive;
+                return ops;
+            }));
+}
+
+void Runner::bench_tt() {
+    if (!selected("TranspositionTable::probe"))
+        return;
+
+    TranspositionTable& tt = engine.tt;
+
+    // Store every child so that the timed loop sees realistic hits
+    for (Key k : childKeys)
+    {
+        auto [hit, data, writer] = tt.probe(k);
+        writer.write(k, VALUE_ZERO, false, BOUND_EXACT, 1, Move::none(), VALUE_ZERO,
+                     tt.generation());
+    }
+
+    add("TranspositionTable::probe", measure(cfg.reps, [&]() {
+            std::uint64_t ops = 0, hits = 0;
+            for (int k = 0; k < 10; ++k)
+                for (Key key : childKeys)
+                {
+                    hits += std::get<0>(tt.probe(key));
+                    ++ops;
+                }
+            Sink = Sink + hits;
+            return ops;
+        }));
+}
+
+void Runner::bench_books() {
+    std::vector<std::unique_ptr<Position>> positions;
+    std::vector<StateInfo>                 roots(corpus.size());
+
+    for (size_t i = 0; i < corpus.size(); ++i)
+    {
+        positions.push_back(std::make_unique<Position>());
+        positions.back()->set(corpus[i].fen, corpus[i].chess960, &roots[i]);
+    }
+
+    if (selected("Experience::probe") && Experience::enabled())
+    {
+        if (!cfg.exp.empty())
+        {
+            std::istringstream is("name Experience File value " + cfg.exp);
+            engine.get_options().setoption(is);
+        }
+
+        // The option is off by default, and init() would unload the file again
+        std::istringstream enable("name Experience Enabled value true");
+        engine.get_options().setoption(enable);
+
+        Experience::init();
+        Experience::wait_for_loading_finished();
+
+        add("Experience::probe", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0, hits = 0;
+                for (int k = 0; k < 10; ++k)
+                    for (Key key : childKeys)
+                    {
+                        hits += Experience::probe(key) != nullptr;
+                        ++ops;
+                    }
+                Sink = Sink + hits;
+                return ops;
+            }));
+
+        // The search pattern: do_move() and then the probe of the new key,
+        // without and with the prefetch issued by do_move()
+        auto stack = std::make_unique<Eval::NNUE::AccumulatorStack>();
+
+        for (bool on : {false, true})
+        {
+            Experience::g_prefetch = on;
+
+            add(on ? "do_move+Experience::probe (pf)" : "do_move+Experience::probe",
+                measure(cfg.reps, [&]() {
+                    StateInfo     st;
+                    std::uint64_t ops = 0, hits = 0;
+
+                    for (size_t i = 0; i < corpus.size(); ++i)
+                        for (Move m : corpus[i].legal)
+                        {
+                            Position& pos             = *positions[i];
+                            auto [dirtyPiece, threats] = stack->push();
+                            pos.do_move(m, st, pos.gives_check(m), dirtyPiece, threats,
+                                        &engine.tt);
+                            hits += Experience::probe(pos.key()) != nullptr;
+                            pos.undo_move(m);
+                            stack->pop();
+                            ++ops;
+                        }
+                    Sink = Sink + hits;
+                    return ops;
+                }));
+        }
+
+        Experience::g_prefetch = false;
+    }
+
+    if (selected("PolyBook::probe") && !cfg.book.empty())
+    {
+        polybook[0].init(cfg.book);
+
+        add("PolyBook::probe", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0;
+                for (auto& pos : positions)
+                {
+                    Sink = Sink + polybook[0].probe(*pos, true, 1).raw();
+                    ++ops;
+                }
+                return ops;
+            }));
+    }
+
+    if (selected("Tablebases::probe_wdl") && !cfg.syzygy.empty())
+    {
+        Tablebases::init(cfg.syzygy);
+
+        std::vector<std::unique_ptr<Position>> endgames;
+        std::vector<StateInfo>                 states(EndgameFens.size());
+
+        for (size_t i = 0; i < EndgameFens.size(); ++i)
+        {
+            auto pos = std::make_unique<Position>();
+            pos->set(EndgameFens[i], false, &states[i]);
+            if (popcount(pos->pieces()) <= Tablebases::MaxCardinality)
+                endgames.push_back(std::move(pos));
+        }
+
+        // The warm-up run maps the files, so the timed runs measure warm probes
+        add("Tablebases::probe_wdl", measure(cfg.reps, [&]() {
+                std::uint64_t ops = 0;
+                for (int k = 0; k < 100; ++k)
+                    for (auto& pos : endgames)
+                    {
+                        Tablebases::ProbeState result;
+                        Sink = Sink + Tablebases::probe_wdl(*pos, &result);
+                        ++ops;
+                    }
+                return ops;
+            }));
+    }
+}
+
+void Runner::bench_nnue() {
+    if (!selected("nnue"))
+        return;
+
+    engine.verify_networks();
+
+    const Eval::NNUE::Networks& nets   = *engine.networks;
+    auto                        stack  = std::make_unique<Eval::NNUE::AccumulatorStack>();
+    auto                        caches = std::make_unique<Eval::NNUE::AccumulatorCaches>(nets);
+
+    std::vector<std::unique_ptr<Position>> positions;
+    std::vector<StateInfo>                 roots(corpus.size());
+
+    for (size_t i = 0; i < corpus.size(); ++i)
+    {
+        positions.push_back(std::make_unique<Position>());
+        positions.back()->set(corpus[i].fen, corpus[i].chess960, &roots[i]);
+    }
+
+    // With an up-to-date accumulator evaluate() is only the transform and propagate
+    const double propagate = measure(cfg.reps, [&]() {
+        std::uint64_t ops = 0;
+        for (auto& pos : positions)
+        {
+            stack->reset();
+            nets.big.evaluate(*pos, *stack, caches->big);
+            for (int k = 0; k < 20; ++k, ++ops)
+                Sink = Sink + std::get<0>(nets.big.evaluate(*pos, *stack, caches->big));
+        }
+        return ops;
+    });
+
+    // Resetting the stack forces a refresh from the accumulator cache
+    const double refresh = measure(cfg.reps, [&]() {
+        std::uint64_t ops = 0;
+        for (int k = 0; k < 10; ++k)
+            for (auto& pos : positions)
+            {
+                stack->reset();
+                Sink = Sink + std::get<0>(nets.big.evaluate(*pos, *stack, caches->big));
+                ++ops;
+            }
+        return ops;
+    });
+
+    const double incremental = measure(cfg.reps, [&]() {
+        StateInfo     st;
+        std::uint64_t ops = 0;
+        for (size_t i = 0; i < corpus.size(); ++i)
+        {
+            Position& pos = *positions[i];
+            stack->reset();
+            nets.big.evaluate(pos, *stack, caches->big);
+
+            for (Move m : corpus[i].legal)
+            {
+                auto [dirtyPiece, threats] = stack->push();
+                pos.do_move(m, st, pos.gives_check(m), dirtyPiece, threats, nullptr);
+                Sink = Sink + std::get<0>(nets.big.evaluate(pos, *stack, caches->big));
+                pos.undo_move(m);
+                stack->pop();
+                ++ops;
+            }
+        }
+        return ops;
+    });
+
+    // Refresh and update are reported net of the propagate cost; the update
+    // also excludes the cost of do_move/undo_move when it was measured.
+    double doUndo = 0;
+    for (const Sample& s : samples)
+        if (s.name == "do_move/undo_move")
+            doUndo = s.nsPerOp;
+
+    add("nnue propagate (big)", propagate);
+    add("nnue refresh (big)", std::max(0.0, refresh - propagate));
+    add("nnue incremental update (big)", std::max(0.0, incremental - propagate - doUndo));
+}
+
+std::vector<Sample> Runner::run() {
+    load_corpus();
+    bench_movegen();
+    bench_tt();
+    bench_books();
+    bench_nnue();
+    return samples;
+}
+
+}  // namespace Hypnos::Microbench
+
+using namespace Hypnos;
+
+int main(int argc, char* argv[]) {
+
+    Bitboards::init();
+    Position::init();
+    Eval::NNUE::Features::init_threat_offsets();
+
+    Microbench::Config cfg;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string key = argv[i], value = argv[i + 1];
+
+        if (key == "reps")
+            cfg.reps = std::max(1, std::atoi(value.c_str()));
+        else if (key == "filter")
+            cfg.filter = value;
+        else if (key == "book")
+            cfg.book = value;
+        else if (key == "exp")
+            cfg.exp = value;
+        else if (key == "syzygy")
+            cfg.syzygy = value;
+        else if (key == "save")
+            cfg.save = value;
+        else if (key == "baseline")
+            cfg.baseline = value;
+        else
+        {
+            std::cerr << "Unknown argument: " << key << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Engine engine(argv[0]);
+    engine.set_on_verify_networks([](std::string_view s) { std::cerr << s << std::endl; });
+
+#if defined(HYP_FIXED_ZOBRIST)
+    Experience::g_benchMode = true;  // Never write the experience file from here
+    HypnosZobrist::SetHypnosZobrist();
+#endif
+
+    const auto samples = Microbench::Runner(engine, cfg).run();
+
+    std::map<std::string, double> baseline;
+    if (!cfg.baseline.empty())
+    {
+        std::ifstream in(cfg.baseline);
+        std::string   line;
+
+        if (!in)
+            std::cerr << "Could not open baseline " << cfg.baseline << std::endl;
+
+        // Names contain spaces, the value is the last field of the line
+        while (std::getline(in, line))
+        {
+            const auto sep = line.find_last_of(' ');
+            if (sep != std::string::npos)
+                baseline[line.substr(0, sep)] = std::atof(line.c_str() + sep + 1);
+        }
+    }
+
+    std::cout << "\n" << std::left << std::setw(32) << "kernel" << std::right << std::setw(12)
+              << "ns/op";
+    if (!baseline.empty())
+        std::cout << std::setw(12) << "baseline" << std::setw(10) << "delta";
+    std::cout << "\n" << std::string(baseline.empty() ? 44 : 66, '-') << "\n";
+
+    for (const auto& s : samples)
+    {
+        std::cout << std::left << std::setw(32) << s.name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << s.nsPerOp;
+
+        auto it = baseline.find(s.name);
+        if (it != baseline.end() && it->second > 0)
+            std::cout << std::setw(12) << it->second << std::setw(9) << std::showpos
+                      << 100.0 * (s.nsPerOp - it->second) / it->second << "%" << std::noshowpos;
+
+        std::cout << "\n";
+    }
+
+    if (!cfg.save.empty())
+    {
+        std::ofstream out(cfg.save);
+        for (const auto& s : samples)
+            out << s.name << " " << std::fixed << std::setprecision(3) << s.nsPerOp << "\n";
+
+        std::cout << "\nSaved baseline to " << cfg.save << std::endl;
+    }
+
+    return 0;
+}
@@ -487,6 +487,16 @@ std::optional<std::string> read_file_to_string(const std::string& path) {
     return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
 }
 
+std::string host_name() {
+#ifdef _WIN32
+    const char* name = std::getenv("COMPUTERNAME");
+    return name && *name ? name : "unknown";
+#else
+    char name[256] = {};
+    return gethostname(name, sizeof(name) - 1) == 0 && *name ? name : "unknown";
+#endif
+}
+
 void remove_whitespace(std::string& s) {
     s.erase(std::remove_if(s.begin(), s.end(), [](char c) { return std::isspace(c); }), s.end());
 }
@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <type_traits>
 #include <vector>
@@ -158,11 +159,31 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
         actualFilename = evalFile.defaultName;
     }
 
-    std::ofstream stream(actualFilename, std::ios_base::binary);
-    bool          saved = save(stream, evalFile.current, evalFile.netDescription);
+    bool saved;
+    {
+        std::ofstream stream(actualFilename, std::ios_base::binary);
+        saved = save(stream, evalFile.current, evalFile.netDescription) && stream.flush();
+    }
 
     msg = saved ? "Network saved successfully to " + actualFilename : "Failed to export a net";
 
+    // Read the file back, the net must come out unchanged. This catches
+    // parameters that do not survive the write/read round trip, such as a
+    // transformed format that the file cannot represent exactly.
+    if (saved)
+    {
+        auto          reloaded = std::make_unique<Network>(evalFile, embeddedType);
+        std::ifstream in(actualFilename, std::ios_base::binary);
+
+        if (!reloaded->load(in).has_value()
+            || reloaded->get_content_hash() != get_content_hash())
+        {
+            msg   = "Failed to export a net: " + actualFilename
+                + " does not read back to the same net";
+            saved = false;
+        }
+    }
+
     sync_cout << msg << sync_endl;
     return saved;
 }
@@ -189,6 +210,18 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
 }
 
 
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::quantize_psq() {
+    featureTransformer.quantize_psq();
+}
+
+
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::psq_int8() const {
+    return featureTransformer.psqInt8;
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string                                  evalfilePath,
                                         const std::function<void(std::string_view)>& f) const {
@@ -225,7 +258,7 @@ void Network<Arch, Transformer>::verify(std::string
           + "MiB, (" + std::to_string(featureTransformer.TotalInputDimensions) + ", "
           + std::to_string(network[0].TransformedFeatureDimensions) + ", "
           + std::to_string(network[0].FC_0_OUTPUTS) + ", " + std::to_string(network[0].FC_1_OUTPUTS)
-          + ", 1))");
+          + ", 1))" + (featureTransformer.psqInt8 ? " with int8 PSQ weights" : ""));
     }
 }
 
@@ -382,9 +415,16 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
     std::uint32_t hashValue;
     if (!read_header(stream, &hashValue, &netDescription))
         return false;
-    if (hashValue != Network::hash)
+    // A quantised file flags both its own hash and that of the transformer
+    const std::uint32_t psqFlag = hashValue == (Network::hash ^ Transformer::Int8PsqHashFlag)
+                                  ? Transformer::Int8PsqHashFlag
+                                  : 0;
+    if ((hashValue ^ psqFlag) != Network::hash)
+        return false;
+    if (read_little_endian<std::uint32_t>(stream) != (Transformer::get_hash_value() ^ psqFlag)
+        || !stream)
         return false;
-    if (!Detail::read_parameters(stream, featureTransformer))
+    if (!featureTransformer.read_parameters(stream, psqFlag != 0))
         return false;
     for (std::size_t i = 0; i < LayerStacks; ++i)
     {
@@ -398,9 +438,12 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
 template<typename Arch, typename Transformer>
 bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
                                                   const std::string& netDescription) const {
-    if (!write_header(stream, Network::hash, netDescription))
+    const std::uint32_t psqFlag =
+      featureTransformer.psqInt8 ? Transformer::Int8PsqHashFlag : 0;
+    if (!write_header(stream, Network::hash ^ psqFlag, netDescription))
         return false;
-    if (!Detail::write_parameters(stream, featureTransformer))
+    write_little_endian<std::uint32_t>(stream, Transformer::get_hash_value() ^ psqFlag);
+    if (!featureTransformer.write_parameters(stream))
         return false;
     for (std::size_t i = 0; i < LayerStacks; ++i)
     {
@@ -78,6 +78,9 @@ class Network {
                            AccumulatorStack&                       accumulatorStack,
                            AccumulatorCaches::Cache<FTDimensions>& cache) const;
 
+    // Switches to int8 piece-square weights, see FeatureTransformer::quantize_psq()
+    void quantize_psq();
+    bool psq_int8() const;
 
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
@@ -308,6 +308,37 @@ void fused_row_reduce(const ElementType* in, ElementType* out, const Ts* const..
           vecIn[i], reinterpret_cast<const typename VectorWrapper::type*>(rows)[i]...);
 }
 
+// Same as fused_row_reduce, but for int8 rows that are widened to 16 bit,
+// combined and then multiplied by a per-element scale before being added
+template<IndexType Width,
+         UpdateOperation... ops,
+         typename... Ts,
+         std::enable_if_t<is_all_same_v<std::int8_t, Ts...>, bool> = true>
+void fused_row_reduce_scaled(const BiasType*   in,
+                             BiasType*         out,
+                             const WeightType* scale,
+                             const Ts* const... rows) {
+#ifdef VECTOR
+    constexpr IndexType size = Width * sizeof(BiasType) / sizeof(vec_t);
+
+    auto* vecIn    = reinterpret_cast<const vec_t*>(in);
+    auto* vecScale = reinterpret_cast<const vec_t*>(scale);
+    auto* vecOut   = reinterpret_cast<vec_t*>(out);
+
+    for (IndexType i = 0; i < size; ++i)
+    {
+        const vec_t delta = fused<Vec16Wrapper, ops...>(vec_zero(), vec_load_8_16(rows, i)...);
+        vecOut[i]         = vec_add_16(vecIn[i], vec_mullo_16(delta, vecScale[i]));
+    }
+#else
+    for (IndexType i = 0; i < Width; ++i)
+    {
+        const BiasType delta = fused<Vec16Wrapper, ops...>(BiasType(0), BiasType(rows[i])...);
+        out[i]               = in[i] + delta * scale[i];
+    }
+#endif
+}
+
 template<typename FeatureSet, IndexType Dimensions>
 struct AccumulatorUpdateContext {
     Color                                 perspective;
@@ -336,10 +367,16 @@ struct AccumulatorUpdateContext {
             return &featureTransformer.psqtWeights[index * PSQTBuckets];
         };
 
-        fused_row_reduce<Vec16Wrapper, Dimensions, ops...>(
-          (from.template acc<Dimensions>()).accumulation[perspective].data(),
-          (to.template acc<Dimensions>()).accumulation[perspective].data(),
-          to_weight_vector(indices)...);
+        if (featureTransformer.psqInt8)
+            fused_row_reduce_scaled<Dimensions, ops...>(
+              (from.template acc<Dimensions>()).accumulation[perspective].data(),
+              (to.template acc<Dimensions>()).accumulation[perspective].data(),
+              featureTransformer.psqScale.data(), featureTransformer.psq_row_int8(indices)...);
+        else
+            fused_row_reduce<Vec16Wrapper, Dimensions, ops...>(
+              (from.template acc<Dimensions>()).accumulation[perspective].data(),
+              (to.template acc<Dimensions>()).accumulation[perspective].data(),
+              to_weight_vector(indices)...);
 
         fused_row_reduce<Vec32Wrapper, PSQTBuckets, ops...>(
           (from.template acc<Dimensions>()).psqtAccumulation[perspective].data(),
@@ -709,6 +746,41 @@ void update_accumulator_refresh_cache(Color                                 pers
           reinterpret_cast<vec_t*>(&accumulator.accumulation[perspective][j * Tiling::TileHeight]);
         auto* entryTile = reinterpret_cast<vec_t*>(&entry.accumulation[j * Tiling::TileHeight]);
 
+        if (featureTransformer.psqInt8)
+        {
+            // Sum the widened rows first and scale the sum once per tile
+            auto* scaleTile =
+              reinterpret_cast<const vec_t*>(&featureTransformer.psqScale[j * Tiling::TileHeight]);
+
+            for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                acc[k] = vec_zero();
+
+            for (const auto index : removed)
+            {
+                const auto* column = featureTransformer.psq_row_int8(index) + j * Tiling::TileHeight;
+
+                for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                    acc[k] = vec_sub_16(acc[k], vec_load_8_16(column, k));
+            }
+            for (const auto index : added)
+            {
+                const auto* column = featureTransformer.psq_row_int8(index) + j * Tiling::TileHeight;
+
+                for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                    acc[k] = vec_add_16(acc[k], vec_load_8_16(column, k));
+            }
+
+            for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                acc[k] = vec_add_16(entryTile[k], vec_mullo_16(acc[k], scaleTile[k]));
+
+            for (IndexType k = 0; k < Tiling::NumRegs; k++)
+                vec_store(&entryTile[k], acc[k]);
+            for (IndexType k = 0; k < Tiling::NumRegs; k++)
+                vec_store(&accTile[k], acc[k]);
+
+            continue;
+        }
+
         for (IndexType k = 0; k < Tiling::NumRegs; ++k)
             acc[k] = entryTile[k];
 
@@ -792,8 +864,13 @@ void update_accumulator_refresh_cache(Color                                 pers
     for (const auto index : removed)
     {
         const IndexType offset = Dimensions * index;
-        for (IndexType j = 0; j < Dimensions; ++j)
-            entry.accumulation[j] -= featureTransformer.weights[offset + j];
+        if (featureTransformer.psqInt8)
+            for (IndexType j = 0; j < Dimensions; ++j)
+                entry.accumulation[j] -=
+                  featureTransformer.psq_row_int8(index)[j] * featureTransformer.psqScale[j];
+        else
+            for (IndexType j = 0; j < Dimensions; ++j)
+                entry.accumulation[j] -= featureTransformer.weights[offset + j];
 
         for (std::size_t k = 0; k < PSQTBuckets; ++k)
             entry.psqtAccumulation[k] -= featureTransformer.psqtWeights[index * PSQTBuckets + k];
@@ -801,8 +878,13 @@ void update_accumulator_refresh_cache(Color                                 pers
     for (const auto index : added)
     {
         const IndexType offset = Dimensions * index;
-        for (IndexType j = 0; j < Dimensions; ++j)
-            entry.accumulation[j] += featureTransformer.weights[offset + j];
+        if (featureTransformer.psqInt8)
+            for (IndexType j = 0; j < Dimensions; ++j)
+                entry.accumulation[j] +=
+                  featureTransformer.psq_row_int8(index)[j] * featureTransformer.psqScale[j];
+        else
+            for (IndexType j = 0; j < Dimensions; ++j)
+                entry.accumulation[j] += featureTransformer.weights[offset + j];
 
         for (std::size_t k = 0; k < PSQTBuckets; ++k)
             entry.psqtAccumulation[k] += featureTransformer.psqtWeights[index * PSQTBuckets + k];
@@ -22,6 +22,8 @@
 #define NNUE_FEATURE_TRANSFORMER_H_INCLUDED
 
 #include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
@@ -48,18 +50,17 @@ invert_permutation(const std::array<std::size_t, Len>& order) {
 
 // Divide a byte region of size TotalSize to chunks of size
 // BlockSize, and permute the blocks by a given order
-template<std::size_t BlockSize, typename T, std::size_t N, std::size_t OrderSize>
-void permute(std::array<T, N>& data, const std::array<std::size_t, OrderSize>& order) {
-    constexpr std::size_t TotalSize = N * sizeof(T);
-
-    static_assert(TotalSize % (BlockSize * OrderSize) == 0,
-                  "ChunkSize * OrderSize must perfectly divide TotalSize");
+template<std::size_t BlockSize, typename T, std::size_t OrderSize>
+void permute(T* data, std::size_t count, const std::array<std::size_t, OrderSize>& order) {
+    const std::size_t TotalSize = count * sizeof(T);
 
     constexpr std::size_t ProcessChunkSize = BlockSize * OrderSize;
 
+    assert(TotalSize % ProcessChunkSize == 0);
+
     std::array<std::byte, ProcessChunkSize> buffer{};
 
-    std::byte* const bytes = reinterpret_cast<std::byte*>(data.data());
+    std::byte* const bytes = reinterpret_cast<std::byte*>(data);
 
     for (std::size_t i = 0; i < TotalSize; i += ProcessChunkSize)
     {
@@ -77,6 +78,14 @@ void permute(std::array<T, N>& data, const std::array<std::size_t, OrderSize>& o
     }
 }
 
+template<std::size_t BlockSize, typename T, std::size_t N, std::size_t OrderSize>
+void permute(std::array<T, N>& data, const std::array<std::size_t, OrderSize>& order) {
+    static_assert(N * sizeof(T) % (BlockSize * OrderSize) == 0,
+                  "ChunkSize * OrderSize must perfectly divide TotalSize");
+
+    permute<BlockSize>(data.data(), N, order);
+}
+
 // Input feature converter
 template<IndexType TransformedFeatureDimensions>
 class FeatureTransformer {
@@ -128,9 +137,20 @@ class FeatureTransformer {
              ^ (OutputDimensions * 2);
     }
 
+    // Xored into the hash values of a file whose piece-square weights are
+    // stored as int8 with a per-neuron scale, see quantize_psq()
+    static constexpr std::uint32_t Int8PsqHashFlag = 0x5A11C0DEu;
+
     void permute_weights() {
         permute<16>(biases, PackusEpi16Order);
-        permute<16>(weights, PackusEpi16Order);
+
+        if (psqInt8)
+        {
+            permute<8>(psq_weights_int8(), HalfDimensions * InputDimensions, PackusEpi16Order);
+            permute<16>(psqScale, PackusEpi16Order);
+        }
+        else
+            permute<16>(weights, PackusEpi16Order);
 
         if (UseThreats)
             permute<8>(threatWeights, PackusEpi16Order);
@@ -138,47 +158,86 @@ class FeatureTransformer {
 
     void unpermute_weights() {
         permute<16>(biases, InversePackusEpi16Order);
-        permute<16>(weights, InversePackusEpi16Order);
+
+        if (psqInt8)
+        {
+            permute<8>(psq_weights_int8(), HalfDimensions * InputDimensions,
+                       InversePackusEpi16Order);
+            permute<16>(psqScale, InversePackusEpi16Order);
+        }
+        else
+            permute<16>(weights, InversePackusEpi16Order);
 
         if (UseThreats)
             permute<8>(threatWeights, InversePackusEpi16Order);
     }
 
     inline void scale_weights(bool read) {
-        for (IndexType j = 0; j < InputDimensions; ++j)
-        {
-            WeightType* w = &weights[j * HalfDimensions];
+        if (psqInt8)
             for (IndexType i = 0; i < HalfDimensions; ++i)
-                w[i] = read ? w[i] * 2 : w[i] / 2;
-        }
+                psqScale[i] = read ? psqScale[i] * 2 : psqScale[i] / 2;
+        else
+            for (IndexType j = 0; j < InputDimensions; ++j)
+            {
+                WeightType* w = &weights[j * HalfDimensions];
+                for (IndexType i = 0; i < HalfDimensions; ++i)
+                    w[i] = read ? w[i] * 2 : w[i] / 2;
+            }
 
         for (IndexType i = 0; i < HalfDimensions; ++i)
             biases[i] = read ? biases[i] * 2 : biases[i] / 2;
     }
 
-    // Read network parameters
+    // Read network parameters. With int8Psq the file stores a per-neuron
+    // scale after the biases and the piece-square weights as int8.
     // TODO: This is ugly. Currently LEB128 on the entire L1 necessitates
     // reading the weights into a combined array, and then splitting.
-    bool read_parameters(std::istream& stream) {
+    bool read_parameters(std::istream& stream, bool int8Psq = false) {
+        psqInt8 = int8Psq;
+
         read_leb_128<BiasType>(stream, biases);
 
+        if (psqInt8)
+        {
+            read_leb_128<WeightType>(stream, psqScale);
+            std::fill(weights.begin(), weights.end(), 0);
+        }
+
         if (UseThreats)
         {
-            auto combinedWeights =
-              std::make_unique<std::array<WeightType, HalfDimensions * TotalInputDimensions>>();
             auto combinedPsqtWeights =
               std::make_unique<std::array<PSQTWeightType, TotalInputDimensions * PSQTBuckets>>();
 
-            read_leb_128<WeightType>(stream, *combinedWeights);
+            if (psqInt8)
+            {
+                auto combinedWeights = std::make_unique<
+                  std::array<std::int8_t, HalfDimensions * TotalInputDimensions>>();
+
+                read_leb_128<std::int8_t>(stream, *combinedWeights);
+
+                std::copy(combinedWeights->begin(),
+                          combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
+                          std::begin(threatWeights));
+
+                std::copy(combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
+                          combinedWeights->end(), psq_weights_int8());
+            }
+            else
+            {
+                auto combinedWeights =
+                  std::make_unique<std::array<WeightType, HalfDimensions * TotalInputDimensions>>();
 
-            std::copy(combinedWeights->begin(),
-                      combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
-                      std::begin(threatWeights));
+                read_leb_128<WeightType>(stream, *combinedWeights);
 
-            std::copy(combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
-                      combinedWeights->begin()
-                        + (ThreatInputDimensions + InputDimensions) * HalfDimensions,
-                      std::begin(weights));
+                std::copy(combinedWeights->begin(),
+                          combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
+                          std::begin(threatWeights));
+
+                std::copy(combinedWeights->begin() + ThreatInputDimensions * HalfDimensions,
+                          combinedWeights->begin()
+                            + (ThreatInputDimensions + InputDimensions) * HalfDimensions,
+                          std::begin(weights));
+            }
 
             read_leb_128<PSQTWeightType>(stream, *combinedPsqtWeights);
 
@@ -193,7 +252,17 @@ class FeatureTransformer {
         }
         else
         {
-            read_leb_128<WeightType>(stream, weights);
+            if (psqInt8)
+            {
+                auto psqWeights =
+                  std::make_unique<std::array<std::int8_t, HalfDimensions * InputDimensions>>();
+
+                read_leb_128<std::int8_t>(stream, *psqWeights);
+                std::copy(psqWeights->begin(), psqWeights->end(), psq_weights_int8());
+            }
+            else
+                read_leb_128<WeightType>(stream, weights);
+
             read_leb_128<PSQTWeightType>(stream, psqtWeights);
         }
 
@@ -216,22 +285,44 @@ class FeatureTransformer {
 
         write_leb_128<BiasType>(stream, copy->biases);
 
+        if (psqInt8)
+            write_leb_128<WeightType>(stream, copy->psqScale);
+
         if (UseThreats)
         {
-            auto combinedWeights =
-              std::make_unique<std::array<WeightType, HalfDimensions * TotalInputDimensions>>();
             auto combinedPsqtWeights =
               std::make_unique<std::array<PSQTWeightType, TotalInputDimensions * PSQTBuckets>>();
 
-            std::copy(std::begin(copy->threatWeights),
-                      std::begin(copy->threatWeights) + ThreatInputDimensions * HalfDimensions,
-                      combinedWeights->begin());
+            if (psqInt8)
+            {
+                auto combinedWeights = std::make_unique<
+                  std::array<std::int8_t, HalfDimensions * TotalInputDimensions>>();
+
+                std::copy(std::begin(copy->threatWeights),
+                          std::begin(copy->threatWeights) + ThreatInputDimensions * HalfDimensions,
+                          combinedWeights->begin());
+
+                std::copy(copy->psq_weights_int8(),
+                          copy->psq_weights_int8() + InputDimensions * HalfDimensions,
+                          combinedWeights->begin() + ThreatInputDimensions * HalfDimensions);
+
+                write_leb_128<std::int8_t>(stream, *combinedWeights);
+            }
+            else
+            {
+                auto combinedWeights =
+                  std::make_unique<std::array<WeightType, HalfDimensions * TotalInputDimensions>>();
+
+                std::copy(std::begin(copy->threatWeights),
+                          std::begin(copy->threatWeights) + ThreatInputDimensions * HalfDimensions,
+                          combinedWeights->begin());
 
-            std::copy(std::begin(copy->weights),
-                      std::begin(copy->weights) + InputDimensions * HalfDimensions,
-                      combinedWeights->begin() + ThreatInputDimensions * HalfDimensions);
+                std::copy(std::begin(copy->weights),
+                          std::begin(copy->weights) + InputDimensions * HalfDimensions,
+                          combinedWeights->begin() + ThreatInputDimensions * HalfDimensions);
 
-            write_leb_128<WeightType>(stream, *combinedWeights);
+                write_leb_128<WeightType>(stream, *combinedWeights);
+            }
 
             std::copy(std::begin(copy->threatPsqtWeights),
                       std::begin(copy->threatPsqtWeights) + ThreatInputDimensions * PSQTBuckets,
@@ -245,19 +336,79 @@ class FeatureTransformer {
         }
         else
         {
-            write_leb_128<WeightType>(stream, copy->weights);
+            if (psqInt8)
+            {
+                auto psqWeights =
+                  std::make_unique<std::array<std::int8_t, HalfDimensions * InputDimensions>>();
+
+                std::copy(copy->psq_weights_int8(),
+                          copy->psq_weights_int8() + InputDimensions * HalfDimensions,
+                          psqWeights->begin());
+                write_leb_128<std::int8_t>(stream, *psqWeights);
+            }
+            else
+                write_leb_128<WeightType>(stream, copy->weights);
+
             write_leb_128<PSQTWeightType>(stream, copy->psqtWeights);
         }
 
         return !stream.fail();
     }
 
+    // Converts the piece-square weights to int8, giving every neuron the
+    // smallest scale that keeps all of its weights within [-127, 127]. The
+    // accumulators are then exact sums of the rounded weights times the scale.
+    // Without threats the weights were doubled by scale_weights() and the
+    // scale is halved again on write, so it is computed on the file weights
+    // and doubled, which keeps it even and the export exact.
+    void quantize_psq() {
+        if (psqInt8)
+            return;
+
+        constexpr int Scaled = UseThreats ? 1 : 2;
+
+        for (IndexType i = 0; i < HalfDimensions; ++i)
+            psqScale[i] = Scaled;
+
+        for (IndexType j = 0; j < InputDimensions; ++j)
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+            {
+                const int w = std::abs(int(weights[j * HalfDimensions + i])) / Scaled;
+                psqScale[i] =
+                  std::max<WeightType>(psqScale[i], WeightType(Scaled * ((w + 126) / 127)));
+            }
+
+        // The int8 rows overlap the int16 ones, so each row is first copied out
+        auto         row = std::make_unique<std::array<WeightType, HalfDimensions>>();
+        std::int8_t* out = psq_weights_int8();
+
+        for (IndexType j = 0; j < InputDimensions; ++j)
+        {
+            std::copy_n(&weights[j * HalfDimensions], HalfDimensions, row->begin());
+
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+                out[j * HalfDimensions + i] = std::int8_t(
+                  std::clamp(std::lround(double((*row)[i]) / psqScale[i]), -127L, 127L));
+        }
+
+        std::fill(weights.begin() + HalfDimensions * InputDimensions / 2, weights.end(), 0);
+        psqInt8 = true;
+    }
+
+    // Row of int8 piece-square weights of a feature, valid when psqInt8. The
+    // rows are packed into the first half of 'weights'.
+    const std::int8_t* psq_row_int8(IndexType index) const {
+        return reinterpret_cast<const std::int8_t*>(weights.data()) + index * HalfDimensions;
+    }
+
     std::size_t get_content_hash() const {
         std::size_t h = 0;
         hash_combine(h, get_raw_data_hash(biases));
         hash_combine(h, get_raw_data_hash(weights));
         hash_combine(h, get_raw_data_hash(psqtWeights));
-        hash_combine(h, get_hash_value());
+        if (psqInt8)
+            hash_combine(h, get_raw_data_hash(psqScale));
+        hash_combine(h, get_hash_value() ^ (psqInt8 ? Int8PsqHashFlag : 0));
         return h;
     }
 
@@ -454,6 +605,11 @@ class FeatureTransformer {
     alignas(CacheLineSize)
       std::array<PSQTWeightType,
                  UseThreats ? ThreatInputDimensions * PSQTBuckets : 0> threatPsqtWeights;
+    alignas(CacheLineSize) std::array<WeightType, HalfDimensions> psqScale;
+    bool psqInt8 = false;
+
+   private:
+    std::int8_t* psq_weights_int8() { return reinterpret_cast<std::int8_t*>(weights.data()); }
 };
 
 }  // namespace Hypnos::Eval::NNUE
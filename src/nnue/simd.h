@@ -57,6 +57,7 @@ using vec_uint_t = __m512i;
     #define vec_add_16(a, b) _mm512_add_epi16(a, b)
     #define vec_sub_16(a, b) _mm512_sub_epi16(a, b)
     #define vec_mulhi_16(a, b) _mm512_mulhi_epi16(a, b)
+    #define vec_mullo_16(a, b) _mm512_mullo_epi16(a, b)
     #define vec_zero() _mm512_setzero_epi32()
     #define vec_set_16(a) _mm512_set1_epi16(a)
     #define vec_max_16(a, b) _mm512_max_epi16(a, b)
@@ -94,6 +95,7 @@ using vec_uint_t = __m256i;
     #define vec_add_16(a, b) _mm256_add_epi16(a, b)
     #define vec_sub_16(a, b) _mm256_sub_epi16(a, b)
     #define vec_mulhi_16(a, b) _mm256_mulhi_epi16(a, b)
+    #define vec_mullo_16(a, b) _mm256_mullo_epi16(a, b)
     #define vec_zero() _mm256_setzero_si256()
     #define vec_set_16(a) _mm256_set1_epi16(a)
     #define vec_max_16(a, b) _mm256_max_epi16(a, b)
@@ -137,6 +139,7 @@ using vec_uint_t = __m128i;
     #define vec_add_16(a, b) _mm_add_epi16(a, b)
     #define vec_sub_16(a, b) _mm_sub_epi16(a, b)
     #define vec_mulhi_16(a, b) _mm_mulhi_epi16(a, b)
+    #define vec_mullo_16(a, b) _mm_mullo_epi16(a, b)
     #define vec_zero() _mm_setzero_si128()
     #define vec_set_16(a) _mm_set1_epi16(a)
     #define vec_max_16(a, b) _mm_max_epi16(a, b)
@@ -191,6 +194,7 @@ using vec_uint_t = uint32x4_t;
     #define vec_add_16(a, b) vaddq_s16(a, b)
     #define vec_sub_16(a, b) vsubq_s16(a, b)
     #define vec_mulhi_16(a, b) vqdmulhq_s16(a, b)
+    #define vec_mullo_16(a, b) vmulq_s16(a, b)
     #define vec_zero() vec_t{0}
     #define vec_set_16(a) vdupq_n_s16(a)
     #define vec_max_16(a, b) vmaxq_s16(a, b)
@@ -224,6 +228,18 @@ inline int8x16_t vmovl_high_s8(int8x16_t val) { return vmovl_s8(vget_high_s8(val
 
 #endif
 
+#ifdef VECTOR
+// Widens the k-th group of int8 values that fills one vec_t
+inline vec_t vec_load_8_16(const std::int8_t* p, IndexType k) {
+    #ifdef USE_NEON
+    const vec_i8_t v = reinterpret_cast<const vec_i8_t*>(p)[k / 2];
+    return k % 2 ? vmovl_high_s8(v) : vmovl_s8(vget_low_s8(v));
+    #else
+    return vec_convert_8_16(reinterpret_cast<const vec_i8_t*>(p)[k]);
+    #endif
+}
+#endif
+
 struct Vec16Wrapper {
 #ifdef VECTOR
     using type = vec_t;
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
@@ -29,6 +30,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
@@ -95,6 +97,100 @@ inline CpuIndex get_hardware_concurrency() {
 
 inline const CpuIndex SYSTEM_THREADS_NB = std::max<CpuIndex>(1, get_hardware_concurrency());
 
+// Resource limits of the control group (cgroup v2) the process runs in, as set
+// up by container runtimes. Each member is empty when the corresponding limit
+// is not set or can't be determined.
+struct CgroupLimits {
+    std::optional<double>             cpuQuota;  // in processors, may be fractional
+    std::optional<std::set<CpuIndex>> cpus;
+    std::optional<size_t>             memoryMax;  // in bytes
+};
+
+inline CgroupLimits get_cgroup_limits() {
+    CgroupLimits limits;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+    // The unified hierarchy is listed as "0::<path>" in /proc/self/cgroup
+    auto procCgroup = read_file_to_string("/proc/self/cgroup");
+    if (!procCgroup.has_value())
+        return limits;
+
+    std::string        relPath;
+    std::istringstream ss(*procCgroup);
+    for (std::string line; std::getline(ss, line);)
+        if (line.rfind("0::", 0) == 0)
+            relPath = line.substr(3);
+
+    remove_whitespace(relPath);
+    if (relPath.empty() || relPath[0] != '/')
+        return limits;
+
+    // Limits of all ancestors apply, so walk up to the root of the mount
+    // and keep the tightest ones. cpuset.cpus.effective already accounts
+    // for the ancestors, so only the innermost one is read.
+    for (std::string dir = "/sys/fs/cgroup" + (relPath == "/" ? "" : relPath);;)
+    {
+        if (auto cpuMax = read_file_to_string(dir + "/cpu.max"))
+        {
+            std::istringstream cs(*cpuMax);
+            std::string        quota;
+            double             period = 0;
+            if (cs >> quota >> period && quota != "max" && period > 0)
+            {
+                const double q = std::stod(quota) / period;
+                if (!limits.cpuQuota.has_value() || q < *limits.cpuQuota)
+                    limits.cpuQuota = q;
+            }
+        }
+
+        if (auto memMax = read_file_to_string(dir + "/memory.max"))
+        {
+            remove_whitespace(*memMax);
+            if (!memMax->empty() && *memMax != "max")
+            {
+                const size_t m = std::stoull(*memMax);
+                if (!limits.memoryMax.has_value() || m < *limits.memoryMax)
+                    limits.memoryMax = m;
+            }
+        }
+
+        if (!limits.cpus.has_value())
+            if (auto cpus = read_file_to_string(dir + "/cpuset.cpus.effective"))
+            {
+                remove_whitespace(*cpus);
+                if (!cpus->empty())
+                {
+                    std::set<CpuIndex> set;
+                    for (const auto& range : split(*cpus, ","))
+                    {
+                        auto parts = split(range, "-");
+                        if (parts.empty() || parts.size() > 2)
+                            continue;
+
+                        const CpuIndex first = std::stoull(std::string(parts.front()));
+                        const CpuIndex last  = std::stoull(std::string(parts.back()));
+                        for (CpuIndex c = first; c <= last; ++c)
+                            set.insert(c);
+                    }
+                    limits.cpus = std::move(set);
+                }
+            }
+
+        const auto slash = dir.find_last_of('/');
+        if (dir == "/sys/fs/cgroup" || slash == std::string::npos)
+            break;
+
+        dir.erase(slash);
+    }
+
+#endif
+
+    return limits;
+}
+
+inline static const CgroupLimits STARTUP_CGROUP_LIMITS = get_cgroup_limits();
+
 #if defined(_WIN64)
 
 struct WindowsAffinity {
@@ -413,6 +509,19 @@ inline std::set<CpuIndex> get_process_affinity() {
 
     CPU_FREE(mask);
 
+    // The kernel normally reflects the cgroup cpuset in the affinity mask,
+    // but be defensive in case the process was started with a stale one.
+    if (STARTUP_CGROUP_LIMITS.cpus.has_value())
+    {
+        std::set<CpuIndex> restricted;
+        for (CpuIndex c : cpus)
+            if (STARTUP_CGROUP_LIMITS.cpus->count(c))
+                restricted.insert(c);
+
+        if (!restricted.empty())
+            cpus = std::move(restricted);
+    }
+
     return cpus;
 }
 
@@ -430,6 +539,22 @@ inline static const auto STARTUP_USE_OLD_AFFINITY_API =
 
 #endif
 
+// Number of threads the process can actually keep busy: processors in the
+// affinity mask, further capped by a cgroup CPU quota (rounded up).
+inline CpuIndex get_available_concurrency() {
+#if defined(__linux__) && !defined(__ANDROID__)
+    CpuIndex concurrency = STARTUP_PROCESSOR_AFFINITY.size();
+#else
+    CpuIndex concurrency = get_hardware_concurrency();
+#endif
+
+    if (STARTUP_CGROUP_LIMITS.cpuQuota.has_value())
+        concurrency =
+          std::min(concurrency, CpuIndex(std::ceil(*STARTUP_CGROUP_LIMITS.cpuQuota - 0.01)));
+
+    return std::max<CpuIndex>(1, concurrency);
+}
+
 // We want to abstract the purpose of storing the numa node index somewhat.
 // Whoever is using this does not need to know the specifics of the replication
 // machinery to be able to access NUMA replicated memory.
@@ -813,10 +938,148 @@ class NumaConfig {
         return ns;
     }
 
+    // Orders the processors such that the first ones each sit on a different
+    // physical core and consecutive ones alternate between the L3 cache domains
+    // (e.g. AMD CCDs), filled proportionally to their size. SMT siblings only
+    // come after every physical core got a thread. Returns the processor for
+    // each of the 'numThreads' threads, or an empty vector when the topology
+    // is not available (only Linux sysfs is supported).
+    std::vector<CpuIndex> distribute_threads_among_cores(CpuIndex numThreads) const {
+        std::vector<CpuIndex> order;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+        // Cores and L3 domains are identified by their lowest processor index
+        auto first_of = [](const std::string& path) -> std::optional<CpuIndex> {
+            auto str = read_file_to_string(path);
+            if (!str.has_value())
+                return std::nullopt;
+
+            remove_whitespace(*str);
+            auto indices = indices_from_shortened_string(*str);
+            if (indices.empty())
+                return std::nullopt;
+
+            return *std::min_element(indices.begin(), indices.end());
+        };
+
+        auto l3_of = [&](CpuIndex c) -> std::optional<CpuIndex> {
+            const std::string cpuPath = "/sys/devices/system/cpu/cpu" + std::to_string(c);
+            for (int i = 0;; ++i)
+            {
+                const std::string indexPath = cpuPath + "/cache/index" + std::to_string(i);
+                auto              level     = read_file_to_string(indexPath + "/level");
+                if (!level.has_value())
+                    return std::nullopt;
+
+                remove_whitespace(*level);
+                if (*level == "3")
+                    return first_of(indexPath + "/shared_cpu_list");
+            }
+        };
+
+        // domain -> core -> processors of the core, all ordered by index
+        std::map<std::pair<NumaIndex, CpuIndex>, std::map<CpuIndex, std::vector<CpuIndex>>>
+          domains;
+
+        for (auto&& [c, n] : nodeByCpu)
+        {
+            const auto core = first_of("/sys/devices/system/cpu/cpu" + std::to_string(c)
+                                       + "/topology/thread_siblings_list");
+            if (!core.has_value())
+                return {};
+
+            // Without L3 information the NUMA node is the only known domain
+            const CpuIndex l3 = l3_of(c).value_or(CpuIndex(0));
+            domains[{n, l3}][*core].push_back(c);
+        }
+
+        // Round k hands out the k-th SMT sibling of every core
+        for (size_t k = 0; order.size() < nodeByCpu.size(); ++k)
+        {
+            std::vector<std::vector<CpuIndex>> queues;
+            for (auto&& [domain, cores] : domains)
+            {
+                queues.emplace_back();
+                for (auto&& [core, cpus] : cores)
+                    if (k < cpus.size())
+                        queues.back().push_back(cpus[k]);
+            }
+
+            std::vector<size_t> taken(queues.size(), 0);
+            for (size_t remaining = 0; true; remaining = 0)
+            {
+                size_t best     = queues.size();
+                float  bestFill = std::numeric_limits<float>::max();
+                for (size_t d = 0; d < queues.size(); ++d)
+                {
+                    if (taken[d] == queues[d].size())
+                        continue;
+
+                    remaining += 1;
+                    const float fill = float(taken[d] + 1) / float(queues[d].size());
+                    if (fill < bestFill)
+                    {
+                        best     = d;
+                        bestFill = fill;
+                    }
+                }
+
+                if (!remaining)
+                    break;
+
+                order.push_back(queues[best][taken[best]++]);
+            }
+        }
+
+#endif
+
+        if (order.empty())
+            return order;
+
+        std::vector<CpuIndex> cpus;
+        for (CpuIndex t = 0; t < numThreads; ++t)
+            cpus.push_back(order[t % order.size()]);
+
+        return cpus;
+    }
+
+    NumaReplicatedAccessToken bind_current_thread_to_cpu(CpuIndex c) const {
+        if (!is_cpu_assigned(c))
+            std::exit(EXIT_FAILURE);
+
+        bind_current_thread_to_cpus({c});
+        return NumaReplicatedAccessToken(nodeByCpu.at(c));
+    }
+
     NumaReplicatedAccessToken bind_current_thread_to_numa_node(NumaIndex n) const {
         if (n >= nodes.size() || nodes[n].size() == 0)
             std::exit(EXIT_FAILURE);
 
+        bind_current_thread_to_cpus(nodes[n]);
+        return NumaReplicatedAccessToken(n);
+    }
+
+    template<typename FuncT>
+    void execute_on_numa_node(NumaIndex n, FuncT&& f) const {
+        std::thread th([this, &f, n]() {
+            bind_current_thread_to_numa_node(n);
+            std::forward<FuncT>(f)();
+        });
+
+        th.join();
+    }
+
+    std::vector<std::set<CpuIndex>> nodes;
+    std::map<CpuIndex, NumaIndex>   nodeByCpu;
+
+   private:
+    CpuIndex highestCpuIndex;
+
+    bool customAffinity;
+
+    void bind_current_thread_to_cpus(const std::set<CpuIndex>& cpus) const {
+
 #if defined(__linux__) && !defined(__ANDROID__)
 
         cpu_set_t* mask = CPU_ALLOC(highestCpuIndex + 1);
@@ -827,7 +1090,7 @@ class NumaConfig {
 
         CPU_ZERO_S(masksize, mask);
 
-        for (CpuIndex c : nodes[n])
+        for (CpuIndex c : cpus)
             CPU_SET_S(c, masksize, mask);
 
         const int status = sched_setaffinity(0, masksize, mask);
@@ -863,7 +1126,7 @@ class NumaConfig {
             for (WORD i = 0; i < numProcGroups; ++i)
                 groupAffinities[i].Group = i;
 
-            for (CpuIndex c : nodes[n])
+            for (CpuIndex c : cpus)
             {
                 const size_t procGroupIndex     = c / WIN_PROCESSOR_GROUP_SIZE;
                 const size_t idxWithinProcGroup = c % WIN_PROCESSOR_GROUP_SIZE;
@@ -904,9 +1167,9 @@ class NumaConfig {
             GROUP_AFFINITY affinity;
             std::memset(&affinity, 0, sizeof(GROUP_AFFINITY));
             // We use an ordered set to be sure to get the smallest cpu number here.
-            const size_t forcedProcGroupIndex = *(nodes[n].begin()) / WIN_PROCESSOR_GROUP_SIZE;
+            const size_t forcedProcGroupIndex = *(cpus.begin()) / WIN_PROCESSOR_GROUP_SIZE;
             affinity.Group                    = static_cast<WORD>(forcedProcGroupIndex);
-            for (CpuIndex c : nodes[n])
+            for (CpuIndex c : cpus)
             {
                 const size_t procGroupIndex     = c / WIN_PROCESSOR_GROUP_SIZE;
                 const size_t idxWithinProcGroup = c % WIN_PROCESSOR_GROUP_SIZE;
@@ -931,28 +1194,8 @@ class NumaConfig {
         }
 
 #endif
-
-        return NumaReplicatedAccessToken(n);
     }
 
-    template<typename FuncT>
-    void execute_on_numa_node(NumaIndex n, FuncT&& f) const {
-        std::thread th([this, &f, n]() {
-            bind_current_thread_to_numa_node(n);
-            std::forward<FuncT>(f)();
-        });
-
-        th.join();
-    }
-
-    std::vector<std::set<CpuIndex>> nodes;
-    std::map<CpuIndex, NumaIndex>   nodeByCpu;
-
-   private:
-    CpuIndex highestCpuIndex;
-
-    bool customAffinity;
-
     static NumaConfig empty() { return NumaConfig(EmptyNodeTag{}); }
 
     struct EmptyNodeTag {};
@@ -0,0 +1,78 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pawns.h"
+
+#include "bitboard.h"
+#include "position.h"
+
+namespace Hypnos::Pawns {
+
+namespace {
+
+// Penalty for the isolated and doubled pawns among the given ones
+int weaknesses(Bitboard pawns) {
+    const Bitboard all     = pawns;
+    int            penalty = 0;
+
+    while (pawns)
+    {
+        const Square sq   = pop_lsb(pawns);
+        const File   file = file_of(sq);
+        Bitboard     adj  = 0;
+
+        if (file > FILE_A)
+            adj |= file_bb(File(file - 1));
+        if (file < FILE_H)
+            adj |= file_bb(File(file + 1));
+
+        if (!(all & adj))
+            penalty += 14;
+        if (more_than_one(all & file_bb(file)))
+            penalty += 10;
+    }
+
+    return penalty;
+}
+
+}  // namespace
+
+const Entry& Table::probe(const Position& pos) {
+    const Key key = pos.pawn_key();
+    Entry&    e   = entries[key & (Size - 1)];
+
+    probeCount++;
+
+    if (e.key == key)
+    {
+        hitCount++;
+        return e;
+    }
+
+    e.key             = key;
+    e.blackWeaknesses = std::int16_t(weaknesses(pos.pieces(BLACK, PAWN)));
+    return e;
+}
+
+void Table::clear() {
+    entries.fill({});
+    hitCount = probeCount = 0;
+}
+
+}  // namespace Hypnos::Pawns
@@ -0,0 +1,64 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PAWNS_H_INCLUDED
+#define PAWNS_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace Hypnos {
+
+class Position;
+
+namespace Pawns {
+
+// Handcrafted evaluation terms that depend only on the pawns, computed once
+// per pawn structure. Further structural terms should be added here.
+struct Entry {
+    Key          key;
+    std::int16_t blackWeaknesses;  // Isolated and doubled Black pawns
+};
+
+// A small per-worker cache of Entry indexed by the pawn key. On a collision
+// the old entry is simply replaced. clear() also resets the hit counters.
+class Table {
+   public:
+    static constexpr std::size_t Size = 16384;
+
+    const Entry& probe(const Position& pos);
+    void         clear();
+
+    std::uint64_t hits() const { return hitCount; }
+    std::uint64_t probes() const { return probeCount; }
+
+   private:
+    std::array<Entry, Size> entries{};
+    std::uint64_t           hitCount   = 0;
+    std::uint64_t           probeCount = 0;
+};
+
+}  // namespace Pawns
+
+}  // namespace Hypnos
+
+#endif  // #ifndef PAWNS_H_INCLUDED
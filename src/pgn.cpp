@@ -0,0 +1,195 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "pgn.h"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "movegen.h"
+#include "position.h"
+#include "uci.h"
+
+namespace Hypnos::PGN {
+
+namespace {
+
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Drops the check marks and annotations, and the '=' of a promotion
+std::string normalize(std::string san) {
+    while (!san.empty() && std::string("+#!?").find(san.back()) != std::string::npos)
+        san.pop_back();
+
+    for (auto& c : san)
+        if (c == '0')
+            c = 'O';
+
+    const auto eq = san.find('=');
+    if (eq != std::string::npos)
+        san.erase(eq, 1);
+
+    return san;
+}
+
+bool is_result(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+}  // namespace
+
+std::string to_san(Position& pos, Move m) {
+    const Square    from = m.from_sq(), to = m.to_sq();
+    const PieceType pt   = type_of(pos.moved_piece(m));
+    std::string     san;
+
+    if (m.type_of() == CASTLING)
+        san = to > from ? "O-O" : "O-O-O";
+    else
+    {
+        if (pt == PAWN)
+        {
+            if (pos.capture(m))
+                san += char('a' + file_of(from));
+        }
+        else
+        {
+            san += " PNBRQK"[pt];
+
+            // Name the file, the rank or both when another piece of the same
+            // type can also reach the square
+            bool ambiguous = false, sameFile = false, sameRank = false;
+
+            for (const auto& other : MoveList<LEGAL>(pos))
+                if (other != m && other.to_sq() == to && other.type_of() != CASTLING
+                    && type_of(pos.moved_piece(other)) == pt)
+                {
+                    ambiguous = true;
+                    sameFile |= file_of(other.from_sq()) == file_of(from);
+                    sameRank |= rank_of(other.from_sq()) == rank_of(from);
+                }
+
+            if (ambiguous && (!sameFile || sameRank))
+                san += char('a' + file_of(from));
+            if (ambiguous && sameFile)
+                san += char('1' + rank_of(from));
+        }
+
+        if (pos.capture(m))
+            san += 'x';
+
+        san += UCIEngine::square(to);
+
+        if (m.type_of() == PROMOTION)
+            san += std::string("=") + " PNBRQK"[m.promotion_type()];
+    }
+
+    if (pos.gives_check(m))
+    {
+        StateInfo st;
+        pos.do_move(m, st);
+        san += MoveList<LEGAL>(pos).size() ? '+' : '#';
+        pos.undo_move(m);
+    }
+
+    return san;
+}
+
+Move from_san(Position& pos, std::string san) {
+    san = normalize(san);
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+        if (normalize(to_san(pos, m)) == san)
+            return m;
+
+    return Move::none();
+}
+
+bool read_game(const std::string& path, std::string& fen, std::vector<std::string>& sanMoves) {
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    fen = StartFEN;
+    sanMoves.clear();
+
+    std::string line, movetext;
+    bool        inMoves = false;
+
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (!line.empty() && line[0] == '[')
+        {
+            // A second game starts with its tags
+            if (inMoves)
+                break;
+
+            if (line.rfind("[FEN \"", 0) == 0)
+                fen = line.substr(6, line.find('"', 6) - 6);
+            continue;
+        }
+
+        // A ';' comment runs to the end of the line
+        if (const auto semicolon = line.find(';'); semicolon != std::string::npos)
+            line.erase(semicolon);
+
+        inMoves |= line.find_first_not_of(" \t") != std::string::npos;
+        movetext += line + ' ';
+    }
+
+    // Remove {comments} and (variations), which may nest
+    std::string main;
+    int         braces = 0, parens = 0;
+
+    for (char c : movetext)
+    {
+        if (c == '{' && !parens)
+            braces++;
+        else if (c == '}' && braces)
+            braces--;
+        else if (!braces && c == '(')
+            parens++;
+        else if (!braces && c == ')' && parens)
+            parens--;
+        else if (!braces && !parens)
+            main += c;
+    }
+
+    std::istringstream ss(main);
+    for (std::string token; ss >> token;)
+    {
+        // Move numbers may be glued to the move, as in "12.Nf3" or "12...Nf6"
+        const auto dots = token.find_last_of('.');
+        if (dots != std::string::npos && std::isdigit(static_cast<unsigned char>(token[0])))
+            token.erase(0, dots + 1);
+
+        if (token.empty() || token[0] == '$' || is_result(token))
+            continue;
+
+        sanMoves.push_back(token);
+    }
+
+    return true;
+}
+
+}  // namespace Hypnos::PGN
@@ -0,0 +1,51 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PGN_H_INCLUDED
+#define PGN_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace Hypnos {
+
+class Position;
+
+namespace PGN {
+
+// Standard algebraic notation of a legal move, with the check or mate mark.
+// The position is only used for do_move()/undo_move() and is left unchanged.
+std::string to_san(Position& pos, Move m);
+
+// The legal move written as 'san', or Move::none(). Check marks, annotation
+// glyphs and a missing '=' before a promotion piece are accepted.
+Move from_san(Position& pos, std::string san);
+
+// Reads the first game of a PGN file: the FEN tag if present, otherwise the
+// standard start position, and the SAN tokens of the main line. Comments,
+// variations, move numbers, NAGs and the result are dropped.
+bool read_game(const std::string& path, std::string& fen, std::vector<std::string>& sanMoves);
+
+}  // namespace PGN
+
+}  // namespace Hypnos
+
+#endif  // #ifndef PGN_H_INCLUDED
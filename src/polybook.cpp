@@ -21,6 +21,7 @@
 #include "movegen.h"
 #include "thread.h"
 #include <iostream>
+#include "memory.h"
 #include "misc.h"
 #include <sys/timeb.h>
 #include <cmath>
@@ -309,7 +310,10 @@ PolyBook::PolyBook() {
 
 PolyBook::~PolyBook() {
     if (polyhash != NULL)
-        delete[] polyhash;
+    {
+        memory_untrack(polyhash);
+        free(polyhash);
+    }
 }
 
 void PolyBook::init(const OptionsMap& options) {
@@ -331,6 +335,7 @@ void PolyBook::init(const std::string& bookfile) {
 
     if (polyhash)
     {
+        memory_untrack(polyhash);
         free(polyhash);
         polyhash = NULL;
     }
@@ -362,6 +367,8 @@ void PolyBook::init(const std::string& bookfile) {
     for (int i = 0; i < keycount; i++)
         byteswap_polyhash(&polyhash[i]);
 
+    memory_track(polyhash, filesize, MemoryTag::Book);
+
     sync_cout << "info string Book loaded: " << bookfile << sync_endl;
 
     enabled = true;
@@ -32,6 +32,7 @@
 #include <utility>
 
 #include "bitboard.h"
+#include "experience.h"
 #include "misc.h"
 #include "movegen.h"
 #include "syzygy/tbprobe.h"
@@ -887,7 +888,11 @@ void Position::do_move(Move                      m,
 
     // If en passant is impossible, then k will not change and we can prefetch earlier
     if (tt && !checkEP)
+    {
         prefetch(tt->first_entry(adjust_key50(k)));
+        if (Experience::g_prefetch)
+            Experience::prefetch(k);
+    }
 
     // Set capture piece
     st->capturedPiece = captured;
@@ -955,7 +960,11 @@ void Position::do_move(Move                      m,
     // Update the key with the final value
     st->key = k;
     if (tt)
+    {
         prefetch(tt->first_entry(key()));
+        if (checkEP && Experience::g_prefetch)
+            Experience::prefetch(k);
+    }
 
     // Calculate the repetition info. It is the ply distance from the previous
     // occurrence of the same position, negative in the 3-fold case, or zero
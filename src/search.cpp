@@ -27,11 +27,13 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <initializer_list>
 #include <iostream>
 #include <list>
 #include <ratio>
 #include <string>
+#include <thread>
 #include <utility>
 
 #if defined(HYP_FIXED_ZOBRIST)
@@ -55,6 +57,7 @@
 #include "syzygy/tbprobe.h"
 #include "thread.h"
 #include "timeman.h"
+#include "trace.h"
 #include "tt.h"
 #include "types.h"
 #include "uci.h"
@@ -67,11 +70,12 @@ thread_local float g_dyn_prev = 0.0f;
 
 namespace TB = Tablebases;
 
-void syzygy_extend_pv(const OptionsMap&            options,
-                      const Search::LimitsType&    limits,
-                      Hypnos::Position&         pos,
-                      Hypnos::Search::RootMove& rootMove,
-                      Value&                       v);
+void syzygy_extend_pv(const OptionsMap&              options,
+                      const Search::LimitsType&      limits,
+                      Hypnos::Position&              pos,
+                      Hypnos::Search::RootMove&      rootMove,
+                      Value&                         v,
+                      Hypnos::Search::SyzygyPvCache& cache);
 
 using namespace Search;
 
@@ -178,6 +182,7 @@ Search::Worker::Worker(SharedState&                    sharedState,
     threads(sharedState.threads),
     tt(sharedState.tt),
     networks(sharedState.networks),
+    cluster(sharedState.cluster),
     refreshTable(networks[token]) {
     clear();
 }
@@ -195,16 +200,32 @@ void Search::Worker::start_searching() {
     // Non-main threads go directly to iterative_deepening()
     if (!is_mainthread())
     {
+        if (limits.mainThreadOnly)
+            return;
+
         iterative_deepening();
+
+        // A speculative search during pondering ends at "ponderhit", after
+        // which the thread helps with the pondered position.
+        if (speculativeRoot && threads.end_speculation(*this))
+        {
+            accumulatorStack.reset();
+            iterative_deepening();
+        }
         return;
     }
 
     main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options,
                             main_manager()->originalTimeAdjust);
+    main_manager()->timePolicy = make_time_policy(options["Time Policy"]);
+    main_manager()->clear_split_lines();
+    main_manager()->syzygyPvCache.clear();
     tt.new_search();
 #if defined(HYP_FIXED_ZOBRIST)
     // Make sure experience has finished loading
     Experience::wait_for_loading_finished();
+    if (Experience::enabled())
+        Experience::prepare_root(rootPos, limits.use_time_management());
 #endif
 
     // Initialize Variety config once per search (cached in this worker)
@@ -319,6 +340,8 @@ void Search::Worker::start_searching() {
     {
         if (!limits.infinite && !limits.mate)
         {
+            TRACE_SCOPE("root_book_probe");
+
             // Built-in policy book with aggressive/solid replies to 1.e4 and 1.d4
             if ((bool) options["Opening Policy"]
                 && rootPos.game_ply() / 2 < (int) options["Opening Policy Depth"])
@@ -345,6 +368,8 @@ void Search::Worker::start_searching() {
                 && rootPos.game_ply() / 2 < (int) options["Experience Book Max Moves"]
                 && Experience::enabled())
             {
+                TRACE_SCOPE("root_experience_probe");
+
                 const auto  expBookMinDepth = Depth(options["Experience Book Min Depth"]);
                 const auto  expBookWidth    = uint32_t(options["Experience Book Width"]);
                 const auto* exp             = Experience::probe(rootPos.key());
@@ -418,14 +443,19 @@ void Search::Worker::start_searching() {
             && std::find(rootMoves.begin(), rootMoves.end(), bookMove) != rootMoves.end())
         {
             for (auto&& th : threads)
-                std::swap(th->worker.get()->rootMoves[0],
-                          *std::find(th->worker.get()->rootMoves.begin(),
-                                     th->worker.get()->rootMoves.end(), bookMove));
+                if (!th->worker->speculativeRoot)
+                    std::swap(th->worker.get()->rootMoves[0],
+                              *std::find(th->worker.get()->rootMoves.begin(),
+                                         th->worker.get()->rootMoves.end(), bookMove));
         }
         else
         {
             threads.start_searching();  // start non-main threads
-            iterative_deepening();      // main thread start searching
+
+            // With "go mate" the helpers search while the main thread runs the
+            // mate solver, which it leaves for the search without a proof
+            if (!limits.mate || !solve_mate())
+                iterative_deepening();  // main thread start searching
         }
     }
 
@@ -444,6 +474,25 @@ void Search::Worker::start_searching() {
     // Wait until all threads have finished
     threads.wait_for_search_finished();
 
+    // The cluster workers search on until told to stop
+    cluster.stop_search();
+
+    // With "MultiPV Split" our own lines were last ordered at the start of the
+    // iteration: take the merged lines of all groups, as the GUI was shown.
+    if (main_manager()->splitActive)
+    {
+        const auto lines = main_manager()->split_lines();
+        for (size_t i = 0; i < lines.size() && i < rootMoves.size(); ++i)
+        {
+            auto it = std::find(rootMoves.begin() + i, rootMoves.end(), lines[i].rm.pv[0]);
+            if (it == rootMoves.end())
+                continue;
+
+            std::rotate(rootMoves.begin() + i, it, it + 1);
+            rootMoves[i] = lines[i].rm;
+        }
+    }
+
 #if defined(HYP_FIXED_ZOBRIST)
     // Always write the PV to the Experience file even for single-run searches.
     // If the GUI requested 'go depth N' but issued 'stop' before the engine
@@ -501,21 +550,10 @@ void Search::Worker::start_searching() {
                 bestMv = bt->rootMoves[0].pv[0];
         }
 
-        // Collect alternatives from all threads
-        for (auto&& th : threads)
-        {
-            auto* w = th->worker.get();
-            if (!w || w->rootMoves.empty() || w->rootMoves[0].pv.empty())
-                continue;
-
-            const Move m0 = w->rootMoves[0].pv[0];
-            if (m0 == Move::none() || m0 == bestMv)
-                continue; // skip the best PV move
-
-            UniqueMoveInfo thisMove{ m0, w->completedDepth,
-                                     w->rootMoves[0].score, 1 };
+        auto add_move = [&](const UniqueMoveInfo& thisMove) {
+            if (thisMove.move == Move::none() || thisMove.move == bestMv)
+                return; // skip the best PV move
 
-            bool merged = false;
             for (auto& um : uniqueMoves)
             {
                 if (um.move == thisMove.move)
@@ -527,12 +565,32 @@ void Search::Worker::start_searching() {
                         um.scoreSum += thisMove.scoreSum;
                         um.count++;
                     }
-                    merged = true;
-                    break;
+                    return;
                 }
             }
-            if (!merged)
-                uniqueMoves.push_back(thisMove);
+            uniqueMoves.push_back(thisMove);
+        };
+
+        // With "MultiPV Split" the first root move of a helper outside group 0
+        // was rotated in from the published lines and not searched by it: take
+        // the lines themselves, at the depth they were searched to.
+        if (main_manager()->splitActive)
+        {
+            for (const auto& line : main_manager()->split_lines())
+                if (!line.rm.pv.empty() && line.rm.score != -VALUE_INFINITE)
+                    add_move({line.rm.pv[0], line.depth, line.rm.score, 1});
+        }
+        else
+        {
+            // Collect alternatives from all threads
+            for (auto&& th : threads)
+            {
+                auto* w = th->worker.get();
+                if (!w || w->speculativeRoot || w->rootMoves.empty() || w->rootMoves[0].pv.empty())
+                    continue;
+
+                add_move({w->rootMoves[0].pv[0], w->completedDepth, w->rootMoves[0].score, 1});
+            }
         }
 
         // Commit MultiPV entries (average score at best depth). Respect MinDepth.
@@ -569,11 +627,33 @@ void Search::Worker::start_searching() {
         && rootMoves[0].pv[0] != Move::none())
         bestThread = threads.get_best_thread()->worker.get();
 
+    // A cluster worker that completed a deeper iteration of this search has the
+    // better root decision, only the TT entries being shared during the search.
+    // Not with a depth or mate limit, whose result must be the local search's,
+    // which also keeps a mate proven by the solver.
+    bool remoteBest = false;
+
+    if (int(options["MultiPV"]) == 1 && !skill.enabled() && bookMove == Move::none()
+        && !limits.depth && !limits.mate)
+    {
+        const auto remote = cluster.best_remote();
+        auto&      rms    = bestThread->rootMoves;
+        auto       it     = std::find(rms.begin(), rms.end(), Move(remote.move));
+
+        if (remote.depth > bestThread->completedDepth && it != rms.end())
+        {
+            std::iter_swap(rms.begin(), it);
+            rms[0].score = rms[0].uciScore = Value(remote.score);
+            rms[0].pv.resize(1);
+            remoteBest = true;
+        }
+    }
+
     main_manager()->bestPreviousScore        = bestThread->rootMoves[0].score;
     main_manager()->bestPreviousAverageScore = bestThread->rootMoves[0].averageScore;
 
-    // Send again PV info if we have a new best thread
-    if (bestThread != this)
+    // Send again PV info if we have a new best thread or a remote best move
+    if (bestThread != this || remoteBest)
         main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth);
 
     std::string ponder;
@@ -589,19 +669,145 @@ void Search::Worker::start_searching() {
         && !main_manager()->ponder && !limits.infinite && !limits.mate
         && rootPos.game_ply() < int(options["Random Open Plies"]))
     {
-        auto& rms = bestThread->rootMoves; // already sorted by score (best at index 0)
-        if (!rms.empty() && rms[0].pv[0] != Move::none())
+        const int deltaCp = int(options["Random Open DeltaCp"]);
+        const int tempCp  = std::max(1, int(options["Random Open SoftmaxT"]));
+
+        struct Candidate {
+            Move              move;
+            Value             score;
+            std::vector<Move> pv;
+        };
+        std::vector<Candidate> candidates;
+
+        auto& rms = bestThread->rootMoves;  // already sorted by score (best at index 0)
+
+        if (bool(options["Random Open Verify"]))
+        {
+            // Candidates are the root moves the search spent most effort on,
+            // plus the best moves of the other threads. Each is searched again
+            // at a reduced depth, the best move included so scores compare.
+            const size_t count = size_t(int(options["Random Open MultiPV"]));
+            std::vector<Move> moves{rms[0].pv[0]};
+
+            std::vector<size_t> helpers;
+            for (size_t t = 0; t < threads.size(); ++t)
+            {
+                const auto& th = *(threads.begin() + t);
+
+                // Threads still on a speculative ponder root searched another position
+                if (th->worker->speculativeRoot)
+                    continue;
+
+                if (t > 0)
+                    helpers.push_back(t);
+
+                const auto& rm = th->worker->rootMoves[0];
+                if (th->worker->completedDepth > 0
+                    && std::find(moves.begin(), moves.end(), rm.pv[0]) == moves.end())
+                    moves.push_back(rm.pv[0]);
+            }
+
+            RootMoves byEffort(rms.begin() + 1, rms.end());
+            std::stable_sort(byEffort.begin(), byEffort.end(),
+                             [](const RootMove& a, const RootMove& b) { return a.effort > b.effort; });
+            for (size_t i = 0; i < byEffort.size() && moves.size() < count; ++i)
+                if (std::find(moves.begin(), moves.end(), byEffort[i].pv[0]) == moves.end())
+                    moves.push_back(byEffort[i].pv[0]);
+
+            const Depth depth = std::max(1, bestThread->completedDepth - 5);
+            const Value best  = rms[0].score;
+            const Value alpha = std::max(best - 2 * deltaCp - 1, -VALUE_INFINITE);
+            const Value beta  = std::min(best + deltaCp + 1, VALUE_INFINITE);
+
+            candidates.resize(moves.size());
+            for (size_t i = 0; i < moves.size(); ++i)
+                candidates[i].move = moves[i];
+
+            // Spread the candidates over the helper threads, or search them here
+            // when there are none.
+            auto verify = [&](Worker& w, size_t first, size_t step) {
+                for (size_t i = first; i < candidates.size(); i += step)
+                    candidates[i].score =
+                      w.search_root_move(candidates[i].move, depth, alpha, beta, candidates[i].pv);
+            };
+
+            // The verification may use an eighth of the nodes of the search,
+            // and no more than the hard time limit of the move
+            const uint64_t searched = threads.nodes_searched();
+            uint64_t       nodeCap  = searched + searched / 8;
+            TimePoint      deadline = 0;
+
+            if (limits.npmsec)
+                nodeCap = std::min(nodeCap, uint64_t(main_manager()->tm.maximum()));
+            else if (limits.use_time_management())
+                deadline = limits.startTime + main_manager()->tm.maximum();
+
+            if (limits.movetime)
+                deadline = deadline ? std::min(deadline, limits.startTime + limits.movetime)
+                                    : limits.startTime + limits.movetime;
+
+            auto set_limit = [&](Worker& w, uint64_t cap) {
+                w.verifyNodes    = cap;
+                w.verifyDeadline = deadline;
+                w.verifyCalls    = 1;
+            };
+
+            threads.stop = false;
+
+            // Without any budget left the best move is kept
+            if (nodeCap <= searched || (deadline && now() >= deadline))
+                threads.stop = true;
+            else if (helpers.empty())
+            {
+                set_limit(*this, nodeCap);
+                verify(*this, 0, 1);
+                set_limit(*this, 0);
+            }
+            else
+            {
+                for (size_t h = 0; h < helpers.size(); ++h)
+                {
+                    Worker* w = (*(threads.begin() + helpers[h]))->worker.get();
+                    set_limit(*w, nodeCap);
+                    threads.run_on_thread(helpers[h], [&, w, h]() { verify(*w, h, helpers.size()); });
+                }
+
+                for (size_t t : helpers)
+                {
+                    threads.wait_on_thread(t);
+                    set_limit(*(*(threads.begin() + t))->worker, 0);
+                }
+            }
+
+            // A "stop" from the GUI or the budget leaves the scores unusable
+            if (threads.stop)
+                candidates.clear();
+
+            threads.stop = true;
+
+            // Fail lows are out of the window, and the remaining candidates
+            // are compared with the best of them rather than the deeper score.
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                            [&](const Candidate& c) { return c.score <= alpha; }),
+                             candidates.end());
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+        }
+        else
         {
-            const int deltaCp = int(options["Random Open DeltaCp"]);
-            int tempCp = int(options["Random Open SoftmaxT"]);
-            if (tempCp < 1) tempCp = 1; // guard
+            // Scores of the MultiPV lines of the search itself
+            for (size_t i = 0; i < rms.size() && rms[i].score != -VALUE_INFINITE; ++i)
+                candidates.push_back({rms[i].pv[0], rms[i].score, rms[i].pv});
+        }
 
+        if (!candidates.empty() && candidates[0].move != Move::none())
+        {
             // Determine how many moves are within deltaCp from the best score; include index 0.
-            const Value best = rms[0].score;
+            const Value best = candidates[0].score;
             int maxPV = 0;
-            for (int i = 1; i < (int)rms.size(); ++i)
+            for (int i = 1; i < (int)candidates.size(); ++i)
             {
-                if (rms[i].score + deltaCp >= best) maxPV = i; else break;
+                if (candidates[i].score + deltaCp >= best) maxPV = i; else break;
             }
 
             if (maxPV > 0) // at least one plausible alternative exists
@@ -611,7 +817,7 @@ void Search::Worker::start_searching() {
                 w[0] = 1.0; // exp(0)
                 for (int i = 1; i <= maxPV; ++i)
                 {
-                    const double x = double(rms[i].score - best) / double(tempCp);
+                    const double x = double(candidates[i].score - best) / double(tempCp);
                     w[i] = std::exp(x);
                 }
                 double sum = 0.0; for (double v : w) sum += v;
@@ -635,24 +841,45 @@ void Search::Worker::start_searching() {
                 int pick = 0;
                 for (int i = 0; i <= maxPV; ++i) { acc += w[i]; if (r <= acc) { pick = i; break; } }
 
-                // If we picked an alternative (pick > 0), move it to the front across all threads for consistency
-                if (pick > 0)
+                // Move the picked move to the front across all threads for consistency,
+                // with the line found for it so the ponder move matches.
+                const Candidate& picked = candidates[pick];
+                if (picked.move != rms[0].pv[0])
                 {
                     for (auto&& th : threads)
                     {
-                        auto& v = th->worker.get()->rootMoves;
-                        if (pick < (int)v.size())
-                            std::swap(v[0], v[pick]);
+                        auto& v  = th->worker.get()->rootMoves;
+                        auto  it = std::find(v.begin(), v.end(), picked.move);
+                        if (it != v.end())
+                        {
+                            std::iter_swap(v.begin(), it);
+                            if (picked.pv.size() > v[0].pv.size())
+                                v[0].pv = picked.pv;
+                        }
                     }
+
+                    ponder.clear();
+                    if (rms[0].pv.size() > 1 || rms[0].extract_ponder_from_tt(tt, rootPos))
+                        ponder = UCIEngine::move(rms[0].pv[1], rootPos.is_chess960());
                 }
             }
         }
     }
 
     auto bestmove = UCIEngine::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
+    main_manager()->tm.on_bestmove(threads.nodes_searched());
     main_manager()->updates.onBestmove(bestmove, ponder);
 }
 
+// The search stops on "stop", and a speculative root also on "ponderhit", so
+// that its threads move to the pondered position without finishing the
+// iteration
+bool Search::Worker::search_aborted() const {
+    return threads.stop.load(std::memory_order_relaxed)
+        || (speculativeRoot.load(std::memory_order_relaxed)
+            && threads.speculationOver.load(std::memory_order_relaxed));
+}
+
 // Main iterative deepening loop. It calls search()
 // repeatedly with increasing depth until the allocated thinking time has been
 // consumed, the user stops the search, or the maximum search depth is reached.
@@ -691,12 +918,24 @@ void Search::Worker::iterative_deepening() {
 
     ss->pv = pv;
 
+    iterationBestMove = Move::none().raw();
+
+    // Iterations of timed searches can be logged to replay time policies offline
+    std::ofstream timeLog;
+
     if (mainThread)
     {
         if (mainThread->bestPreviousScore == VALUE_INFINITE)
             mainThread->iterValue.fill(VALUE_ZERO);
         else
             mainThread->iterValue.fill(mainThread->bestPreviousScore);
+
+        const std::string timeLogFile = options["Time Log File"];
+        if (!timeLogFile.empty() && limits.use_time_management())
+        {
+            timeLog.open(timeLogFile, std::ios::app);
+            log_search_start(timeLog, rootPos.fen());
+        }
     }
 
     size_t multiPV = size_t(options["MultiPV"]);
@@ -707,20 +946,38 @@ void Search::Worker::iterative_deepening() {
     if (skill.enabled())
         multiPV = std::max(multiPV, size_t(4));
 
-    // Opening variety: raise MultiPV in the first N plies to gather alternatives
-    if (rootPos.game_ply() < int(options["Random Open Plies"]))
+    // Opening variety: raise MultiPV in the first N plies to gather alternatives,
+    // unless they get scored by a cheaper verification search afterwards.
+    if (bool(options["Random Open Mode"]) && !bool(options["Random Open Verify"])
+        && rootPos.game_ply() < int(options["Random Open Plies"]))
         multiPV = std::max(multiPV, size_t(int(options["Random Open MultiPV"])));
 
     multiPV = std::min(multiPV, rootMoves.size());
 
+    // With "MultiPV Split" line i is only searched by the threads of group i mod
+    // splitGroups, instead of every thread searching every line. Tablebase
+    // ranking at root groups lines by rank, which the split does not respect.
+    const size_t splitGroups = bool(options["MultiPV Split"]) && multiPV > 1
+                                  && threads.size() > 1 && !limits.mainThreadOnly
+                                  && !tbConfig.rootInTB
+                                  && !threads.speculating()
+                               ? std::min(threads.size(), multiPV)
+                               : 1;
+    const size_t splitGroup  = threadIdx % splitGroups;
+
+    if (mainThread)
+        mainThread->splitActive = splitGroups > 1;
+
     int searchAgainCounter = 0;
 
     lowPlyHistory.fill(97);
 
     // Iterative deepening loop until requested to stop or the target depth is reached
-    while (++rootDepth < MAX_PLY && !threads.stop
+    while (++rootDepth < MAX_PLY && !search_aborted()
            && !(limits.depth && mainThread && rootDepth > limits.depth))
     {
+        TRACE_SCOPE("iteration");
+
         // Reset dynamic EMA at the start of each root iteration
         g_dyn_prev = 0.0f;
 
@@ -736,6 +993,23 @@ void Search::Worker::iterative_deepening() {
         if (mainThread)
             totBestMoveChanges /= 2;
 
+        // Order the lines as merged from all groups, so that each line excludes
+        // the moves the other groups found above it.
+        if (splitGroups > 1)
+        {
+            const auto lines = threads.main_manager()->split_lines();
+            for (size_t i = 0; i < lines.size() && i < rootMoves.size(); ++i)
+            {
+                auto it = std::find(rootMoves.begin() + i, rootMoves.end(), lines[i].rm.pv[0]);
+                if (it == rootMoves.end())
+                    continue;
+
+                std::rotate(rootMoves.begin() + i, it, it + 1);
+                rootMoves[i].averageScore     = lines[i].rm.averageScore;
+                rootMoves[i].meanSquaredScore = lines[i].rm.meanSquaredScore;
+            }
+        }
+
         // Save the last iteration's scores before the first PV line is searched and
         // all the move scores except the (new) PV are set to -VALUE_INFINITE.
         for (RootMove& rm : rootMoves)
@@ -758,6 +1032,9 @@ void Search::Worker::iterative_deepening() {
                         break;
             }
 
+            if (pvIdx % splitGroups != splitGroup)
+                continue;
+
             // Reset UCI info selDepth for each depth and each PV line
             selDepth = 0;
 
@@ -795,7 +1072,7 @@ void Search::Worker::iterative_deepening() {
                 // If search has been stopped, we break immediately. Sorting is
                 // safe because RootMoves is still valid, although it refers to
                 // the previous iteration.
-                if (threads.stop)
+                if (search_aborted())
                     break;
 
                 // When failing high/low give some update before a re-search. To avoid
@@ -825,11 +1102,25 @@ void Search::Worker::iterative_deepening() {
                 else
                     break;
 
+                TRACE_INSTANT("aspiration_research");
                 delta += delta / 3;
 
                 assert(alpha >= -VALUE_INFINITE && beta <= VALUE_INFINITE);
             }
 
+            // Lines of other groups are not in sync with ours, so keep the
+            // order and let the main thread merge the published results.
+            if (splitGroups > 1)
+            {
+                if (!search_aborted())
+                    threads.main_manager()->publish_split_line(pvIdx, rootDepth, rootMoves[pvIdx]);
+
+                if (search_aborted())
+                    break;
+
+                continue;
+            }
+
             // Sort the PV lines searched so far and update the GUI
             std::stable_sort(rootMoves.begin() + pvFirst, rootMoves.begin() + pvIdx + 1);
 
@@ -843,11 +1134,14 @@ void Search::Worker::iterative_deepening() {
                 && !(threads.abortedSearch && is_loss(rootMoves[0].uciScore)))
                 main_manager()->pv(*this, threads, tt, rootDepth);
 
-            if (threads.stop)
+            if (search_aborted())
                 break;
         }
 
-        if (!threads.stop)
+        if (mainThread && splitGroups > 1)
+            main_manager()->pv(*this, threads, tt, rootDepth);
+
+        if (!search_aborted())
             completedDepth = rootDepth;
 
         // We make sure not to pick an unproven mated-in score,
@@ -868,6 +1162,13 @@ void Search::Worker::iterative_deepening() {
             lastBestMoveDepth = rootDepth;
         }
 
+        // Published for the main thread's time management
+        iterationBestMove = rootMoves[0].pv[0].raw();
+
+        if (mainThread && !threads.stop)
+            cluster.share_root(completedDepth, rootMoves[0].score, rootMoves[0].pv[0],
+                               threads.nodes_searched());
+
         if (!mainThread)
             continue;
 
@@ -887,41 +1188,45 @@ void Search::Worker::iterative_deepening() {
         // Use part of the gained time from a previous stable move for the current move
         for (auto&& th : threads)
         {
-            totBestMoveChanges += th->worker->bestMoveChanges;
+            if (!th->worker->speculativeRoot)
+                totBestMoveChanges += th->worker->bestMoveChanges;
             th->worker->bestMoveChanges = 0;
         }
 
         // Do we have time for the next iteration? Can we stop searching now?
         if (limits.use_time_management() && !threads.stop && !mainThread->stopOnPonderhit)
         {
-            uint64_t nodesEffort =
-              rootMoves[0].effort * 100000 / std::max(size_t(1), size_t(nodes));
-
-            double fallingEval = (11.85 + 2.24 * (mainThread->bestPreviousAverageScore - bestValue)
-                                  + 0.93 * (mainThread->iterValue[iterIdx] - bestValue))
-                               / 100.0;
-            fallingEval = std::clamp(fallingEval, 0.57, 1.70);
-
-            // If the bestMove is stable over several iterations, reduce time accordingly
-            double k      = 0.51;
-            double center = lastBestMoveDepth + 12.15;
-
-            timeReduction = 0.66 + 0.85 / (0.98 + std::exp(-k * (completedDepth - center)));
-
-            double reduction = (1.43 + mainThread->previousTimeReduction) / (2.28 * timeReduction);
-
-            double bestMoveInstability = 1.02 + 2.14 * totBestMoveChanges / threads.size();
-
-            double highBestMoveEffort = nodesEffort >= 93340 ? 0.76 : 1.0;
-
-            double totalTime = mainThread->tm.optimum() * fallingEval * reduction
-                             * bestMoveInstability * highBestMoveEffort;
-
-            // Cap used time in case of a single legal move for a better viewer experience
-            if (rootMoves.size() == 1)
-                totalTime = std::min(502.0, totalTime);
-
-            auto elapsedTime = elapsed();
+            size_t agreeing = 0;
+            for (auto&& th : threads)
+                agreeing += !th->worker->speculativeRoot
+                         && th->worker->iterationBestMove == rootMoves[0].pv[0].raw();
+
+            IterationStats stats;
+            stats.elapsed                  = elapsed();
+            stats.optimum                  = mainThread->tm.optimum();
+            stats.maximum                  = mainThread->tm.maximum();
+            stats.depth                    = completedDepth;
+            stats.lastBestMoveDepth        = lastBestMoveDepth;
+            stats.bestValue                = bestValue;
+            stats.bestPreviousAverageScore = mainThread->bestPreviousAverageScore;
+            stats.iterValue                = mainThread->iterValue[iterIdx];
+            stats.previousTimeReduction    = mainThread->previousTimeReduction;
+            stats.bestMoveChanges          = totBestMoveChanges;
+            stats.threads                  = threads.size();
+            stats.rootMoves                = rootMoves.size();
+            stats.nodes                    = nodes;
+            stats.bestMoveEffort           = rootMoves[0].effort;
+            stats.agreement                = double(agreeing) / threads.size();
+
+            const TimeDecision decision = mainThread->timePolicy->decide(stats);
+            const double       totalTime = decision.totalTime;
+            timeReduction                = decision.timeReduction;
+
+            if (timeLog.is_open())
+                log_iteration(timeLog, stats,
+                              UCIEngine::move(rootMoves[0].pv[0], rootPos.is_chess960()));
+
+            auto elapsedTime = stats.elapsed;
 
             // Stop the search if we have exceeded the totalTime or maximum
             if (elapsedTime > std::min(totalTime, double(mainThread->tm.maximum())))
@@ -954,6 +1259,55 @@ void Search::Worker::iterative_deepening() {
 }
 
 
+// Stops the verification searches once they use up their share of nodes or
+// reach the hard time limit
+void Search::Worker::check_verify_limit() {
+    if (--verifyCalls > 0)
+        return;
+
+    verifyCalls = 512;
+
+    if (threads.nodes_searched() >= verifyNodes || (verifyDeadline && now() >= verifyDeadline))
+        threads.stop = true;
+}
+
+Value Search::Worker::search_root_move(
+  Move m, Depth depth, Value alpha, Value beta, std::vector<Move>& pvOut) {
+
+    Move      pv[MAX_PLY + 1];
+    StateInfo st;
+
+    // Same stack layout as in iterative_deepening()
+    Stack  stack[MAX_PLY + 10] = {};
+    Stack* ss                  = stack + 7;
+
+    for (int i = 7; i > 0; --i)
+    {
+        (ss - i)->continuationHistory           = &continuationHistory[0][0][NO_PIECE][0];
+        (ss - i)->continuationCorrectionHistory = &continuationCorrectionHistory[NO_PIECE][0];
+        (ss - i)->staticEval                    = VALUE_NONE;
+    }
+
+    for (int i = 0; i <= MAX_PLY + 2; ++i)
+        (ss + i)->ply = i;
+
+    ss->inCheck     = rootPos.checkers();
+    (ss + 1)->pv    = pv;
+    (ss + 1)->pv[0] = Move::none();
+    rootDelta       = beta - alpha;
+    selDepth        = 0;
+
+    do_move(rootPos, m, st, ss);
+    Value value = -search<PV>(rootPos, ss + 1, -beta, -alpha, depth - 1, false);
+    undo_move(rootPos, m);
+
+    pvOut.assign(1, m);
+    for (Move* p = pv; *p != Move::none(); ++p)
+        pvOut.push_back(*p);
+
+    return value;
+}
+
 void Search::Worker::do_move(Position& pos, const Move move, StateInfo& st, Stack* const ss) {
     do_move(pos, move, st, pos.gives_check(move), ss);
 }
@@ -1017,6 +1371,7 @@ void Search::Worker::clear() {
         reductions[i] = int(2747 / 128.0 * std::log(i));
 
     refreshTable.clear(networks[numaAccessToken]);
+    pawnTable.clear();
 }
 
 
@@ -1085,7 +1440,9 @@ Value Search::Worker::search(
     maxValue      = VALUE_INFINITE;
 
     // Check for the available remaining time
-    if (is_mainthread())
+    if (verifyNodes)
+        check_verify_limit();
+    else if (is_mainthread())
         main_manager()->check_time(*this);
 
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
@@ -1095,8 +1452,7 @@ Value Search::Worker::search(
     if (!rootNode)
     {
         // Step 2. Check for aborted search and immediate draw
-        if (threads.stop.load(std::memory_order_relaxed) || pos.is_draw(ss->ply)
-            || ss->ply >= MAX_PLY)
+        if (search_aborted() || pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
             return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos) : value_draw(nodes);
 
         // Step 3. Mate distance pruning. Even if we mate at the next move our score
@@ -1946,7 +2302,7 @@ moves_loop:  // When in check, search starts here
         // Finished searching the move. If a stop occurred, the return value of
         // the search cannot be trusted, and we return immediately without updating
         // best move, principal variation nor transposition table.
-        if (threads.stop.load(std::memory_order_relaxed))
+        if (search_aborted())
             return VALUE_ZERO;
 
         if (rootNode)
@@ -2118,6 +2474,15 @@ moves_loop:  // When in check, search starts here
                        moveCount != 0 ? depth : std::min(MAX_PLY - 1, depth + 6), bestMove,
                        unadjustedStaticEval, tt.generation());
 
+    // Deep results are worth sending to the other nodes of a cluster
+    if (depth >= Distributed::ShareDepth && !excludedMove && !(rootNode && pvIdx)
+        && cluster.sharing())
+        cluster.share(posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
+                      bestValue >= beta    ? BOUND_LOWER
+                      : PvNode && bestMove ? BOUND_EXACT
+                                           : BOUND_UPPER,
+                      depth, bestMove, unadjustedStaticEval);
+
     // Adjust correction history if the best move is not a capture
     // and the error direction matches whether we are above/below bounds.
     if (!ss->inCheck && !(bestMove && pos.capture(bestMove))
@@ -2430,7 +2795,54 @@ TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elaps
 
 Value Search::Worker::evaluate(const Position& pos) {
     return Eval::evaluate(networks[numaAccessToken], pos, accumulatorStack, refreshTable,
-                          optimism[pos.side_to_move()]);
+                          pawnTable, optimism[pos.side_to_move()]);
+}
+
+// Runs the df-pn solver on the main thread while the helpers already run the
+// alpha-beta search. When a mate is proven its line becomes the best root move
+// and the main thread does not search, otherwise it joins the helpers with
+// what is left of the limits.
+bool Search::Worker::solve_mate() {
+    if (!options["Mate Solver"])
+        return false;
+
+    std::uint64_t budget = std::uint64_t(int(options["Mate Solver Nodes"])) * 1000;
+    if (limits.nodes)
+        budget = std::min<std::uint64_t>(budget, limits.nodes);
+
+    // Keep most of a time limit for the fallback search
+    auto stop = [&]() {
+        return threads.stop.load(std::memory_order_relaxed)
+            || (limits.use_time_management() && elapsed() >= main_manager()->tm.optimum() / 2)
+            || (limits.movetime && elapsed() >= limits.movetime / 2);
+    };
+
+    std::vector<Move> moves;
+    for (const auto& rm : rootMoves)
+        moves.push_back(rm.pv[0]);
+
+    main_manager()->mateSolver.resize(size_t(int(options["Mate Solver Hash"])));
+    const auto result = main_manager()->mateSolver.solve(rootPos, moves, limits.mate, budget, stop);
+
+    this->nodes += result.nodes;
+
+    if (!result.mateIn)
+    {
+        sync_cout << "info string Mate Solver found no mate in " << limits.mate << " within "
+                  << result.nodes << " nodes, searching" << sync_endl;
+        return false;
+    }
+
+    auto it = std::find(rootMoves.begin(), rootMoves.end(), result.pv[0]);
+    std::swap(rootMoves[0], *it);
+
+    rootMoves[0].pv       = result.pv;
+    rootMoves[0].score    = rootMoves[0].uciScore = mate_in(2 * result.mateIn - 1);
+    rootMoves[0].selDepth = int(result.pv.size());
+    completedDepth = rootDepth = 2 * result.mateIn - 1;
+
+    main_manager()->pv(*this, threads, tt, completedDepth);
+    return true;
 }
 
 namespace {
@@ -2613,9 +3025,22 @@ void SearchManager::check_time(Search::Worker& worker) {
     if (--callsCnt > 0)
         return;
 
+    TRACE_SCOPE("check_time");
+
     // When using nodes, ensure checking rate is not lower than 0.1% of nodes
     callsCnt = worker.limits.nodes ? std::min(512, int(worker.limits.nodes / 1024)) : 512;
 
+    // With a nodes per second budget, sleep off the nodes searched ahead of it
+    // in short steps, so that the time checks below keep their resolution.
+    if (worker.limits.nps)
+    {
+        TimePoint ahead = TimePoint(worker.threads.nodes_searched() * 1000 / worker.limits.nps)
+                        - (now() - worker.limits.startTime);
+
+        if (ahead > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min<TimePoint>(ahead, 10)));
+    }
+
     static TimePoint lastInfoTime = now();
 
     TimePoint elapsed = tm.elapsed([&worker]() { return worker.threads.nodes_searched(); });
@@ -2649,12 +3074,36 @@ void syzygy_extend_pv(const OptionsMap&         options,
                       const Search::LimitsType& limits,
                       Position&                 pos,
                       RootMove&                 rootMove,
-                      Value&                    v) {
+                      Value&                    v,
+                      SyzygyPvCache&            cache) {
+
+    // The root is the same for the whole search, the PV and score identify the line
+    Key lineKey = make_key(uint64_t(v - VALUE_NONE));
+    for (Move m : rootMove.pv)
+        lineKey = make_key(lineKey ^ m.raw());
+
+    if (auto it = cache.lines.find(lineKey); it != cache.lines.end())
+    {
+        rootMove.pv = it->second.pv;
+        v           = it->second.v;
+        return;
+    }
 
     auto t_start      = std::chrono::steady_clock::now();
-    int  moveOverhead = int(options["Move Overhead"]);
+    int  moveOverhead = int(options["MoveOverhead"]);
     bool rule50       = bool(options["Syzygy50MoveRule"]);
 
+    // TB rankings depend on the 50-move counter and on repetitions, not only on the key
+    auto tb_key = [&pos]() {
+        return pos.key() ^ make_key(uint64_t(pos.rule50_count()) * 2 + pos.has_repeated());
+    };
+
+    auto remember = [](auto& map, Key key, auto&& value) {
+        if (map.size() >= SyzygyPvCache::MaxEntries)
+            map.clear();
+        map.emplace(key, std::forward<decltype(value)>(value));
+    };
+
     // Do not use more than moveOverhead / 2 time, if time management is active
     auto time_abort = [&t_start, &moveOverhead, &limits]() -> bool {
         auto t_end = std::chrono::steady_clock::now();
@@ -2675,13 +3124,28 @@ void syzygy_extend_pv(const OptionsMap&         options,
     {
         Move& pvMove = rootMove.pv[ply];
 
-        RootMoves legalMoves;
-        for (const auto& m : MoveList<LEGAL>(pos))
-            legalMoves.emplace_back(m);
+        SyzygyPvCache::Ranking        fresh;
+        const SyzygyPvCache::Ranking* ranking = &fresh;
+        const Key                     key     = tb_key();
 
-        Tablebases::Config config =
-          Tablebases::rank_root_moves(options, pos, legalMoves, false, time_abort);
-        RootMove& rm = *std::find(legalMoves.begin(), legalMoves.end(), pvMove);
+        if (auto it = cache.rankings.find(key); it != cache.rankings.end())
+            ranking = &it->second;
+        else
+        {
+            for (const auto& m : MoveList<LEGAL>(pos))
+                fresh.moves.emplace_back(m);
+
+            fresh.config =
+              Tablebases::rank_root_moves(options, pos, fresh.moves, false, time_abort);
+
+            // An interrupted ranking is incomplete, it is used this time only
+            if (!time_abort())
+                remember(cache.rankings, key, fresh);
+        }
+
+        const Tablebases::Config& config     = ranking->config;
+        const RootMoves&          legalMoves = ranking->moves;
+        const RootMove& rm = *std::find(legalMoves.begin(), legalMoves.end(), pvMove);
 
         if (legalMoves[0].tbRank != rm.tbRank)
             break;
@@ -2716,40 +3180,54 @@ void syzygy_extend_pv(const OptionsMap&         options,
         if (time_abort())
             break;
 
-        RootMoves legalMoves;
-        for (const auto& m : MoveList<LEGAL>(pos))
-        {
-            auto&     rm = legalMoves.emplace_back(m);
-            StateInfo tmpSI;
-            pos.do_move(m, tmpSI);
-            // Give a score of each move to break DTZ ties restricting opponent mobility,
-            // but not giving the opponent a capture.
-            for (const auto& mOpp : MoveList<LEGAL>(pos))
-                rm.tbRank -= pos.capture(mOpp) ? 100 : 1;
-            pos.undo_move(m);
-        }
+        const Key key    = tb_key();
+        Move      pvMove = Move::none();
 
-        // Mate found
-        if (legalMoves.size() == 0)
-            break;
+        if (auto it = cache.extensions.find(key); it != cache.extensions.end())
+            pvMove = it->second;
+        else
+        {
+            RootMoves legalMoves;
+            for (const auto& m : MoveList<LEGAL>(pos))
+            {
+                auto&     rm = legalMoves.emplace_back(m);
+                StateInfo tmpSI;
+                pos.do_move(m, tmpSI);
+                // Give a score of each move to break DTZ ties restricting opponent mobility,
+                // but not giving the opponent a capture.
+                for (const auto& mOpp : MoveList<LEGAL>(pos))
+                    rm.tbRank -= pos.capture(mOpp) ? 100 : 1;
+                pos.undo_move(m);
+            }
 
-        // Sort moves according to their above assigned rank.
-        // This will break ties for moves with equal DTZ in rank_root_moves.
-        std::stable_sort(
-          legalMoves.begin(), legalMoves.end(),
-          [](const Search::RootMove& a, const Search::RootMove& b) { return a.tbRank > b.tbRank; });
+            // No move means mate found
+            if (legalMoves.size())
+            {
+                // Sort moves according to their above assigned rank.
+                // This will break ties for moves with equal DTZ in rank_root_moves.
+                std::stable_sort(legalMoves.begin(), legalMoves.end(),
+                                 [](const Search::RootMove& a, const Search::RootMove& b) {
+                                     return a.tbRank > b.tbRank;
+                                 });
+
+                // The winning side tries to minimize DTZ, the losing side maximizes it
+                Tablebases::Config config =
+                  Tablebases::rank_root_moves(options, pos, legalMoves, true, time_abort);
+
+                // If DTZ is not available we might not find a mate, so we bail out
+                if (config.rootInTB && config.cardinality <= 0)
+                    pvMove = legalMoves[0].pv[0];
+            }
 
-        // The winning side tries to minimize DTZ, the losing side maximizes it
-        Tablebases::Config config =
-          Tablebases::rank_root_moves(options, pos, legalMoves, true, time_abort);
+            if (!time_abort())
+                remember(cache.extensions, key, pvMove);
+        }
 
-        // If DTZ is not available we might not find a mate, so we bail out
-        if (!config.rootInTB || config.cardinality > 0)
+        if (pvMove == Move::none())
             break;
 
         ply++;
 
-        Move& pvMove = legalMoves[0].pv[0];
         rootMove.pv.push_back(pvMove);
         auto& st = sts.emplace_back();
         pos.do_move(pvMove, st);
@@ -2772,11 +3250,13 @@ void syzygy_extend_pv(const OptionsMap&         options,
     for (auto it = rootMove.pv.rbegin(); it != rootMove.pv.rend(); ++it)
         pos.undo_move(*it);
 
-    // Inform if we couldn't get a full extension in time
+    // Inform if we couldn't get a full extension in time, otherwise keep the result
     if (time_abort())
         sync_cout
-          << "info string Syzygy based PV extension requires more time, increase Move Overhead as needed."
+          << "info string Syzygy based PV extension requires more time, increase MoveOverhead as needed."
           << sync_endl;
+    else
+        remember(cache.lines, lineKey, SyzygyPvCache::Line{rootMove.pv, v});
 }
 
 void SearchManager::pv(Search::Worker&           worker,
@@ -2784,10 +3264,20 @@ void SearchManager::pv(Search::Worker&           worker,
                        const TranspositionTable& tt,
                        Depth                     depth) {
 
+    // In split mode the lines come from all groups, and each is complete
+    RootMoves          splitMoves;
+    std::vector<Depth> splitDepths;
+    if (splitActive)
+        for (auto&& line : split_lines())
+        {
+            splitMoves.push_back(line.rm);
+            splitDepths.push_back(line.depth);
+        }
+
     const auto nodes     = threads.nodes_searched();
-    auto&      rootMoves = worker.rootMoves;
+    auto&      rootMoves = splitActive ? splitMoves : worker.rootMoves;
     auto&      pos       = worker.rootPos;
-    size_t     pvIdx     = worker.pvIdx;
+    size_t     pvIdx     = splitActive ? rootMoves.size() : worker.pvIdx;
     size_t     multiPV   = std::min(size_t(worker.options["MultiPV"]), rootMoves.size());
     uint64_t   tbHits    = threads.tb_hits() + (worker.tbConfig.rootInTB ? rootMoves.size() : 0);
 
@@ -2798,7 +3288,7 @@ void SearchManager::pv(Search::Worker&           worker,
         if (depth == 1 && !updated && i > 0)
             continue;
 
-        Depth d = updated ? depth : std::max(1, depth - 1);
+        Depth d = splitActive ? splitDepths[i] : updated ? depth : std::max(1, depth - 1);
         Value v = updated ? rootMoves[i].uciScore : rootMoves[i].previousScore;
 
         if (v == -VALUE_INFINITE)
@@ -2812,7 +3302,7 @@ void SearchManager::pv(Search::Worker&           worker,
         // Potentially correct and extend the PV, and in exceptional cases v
         if (is_decisive(v) && std::abs(v) < VALUE_MATE_IN_MAX_PLY
             && ((!rootMoves[i].scoreLowerbound && !rootMoves[i].scoreUpperbound) || isExact))
-            syzygy_extend_pv(worker.options, worker.limits, pos, rootMoves[i], v);
+            syzygy_extend_pv(worker.options, worker.limits, pos, rootMoves[i], v, syzygyPvCache);
 
         std::string pv;
         for (Move m : rootMoves[i].pv)
@@ -2852,6 +3342,43 @@ void SearchManager::pv(Search::Worker&           worker,
     }
 }
 
+void SearchManager::clear_split_lines() {
+    std::lock_guard<std::mutex> lock(splitMutex);
+    splitLines.clear();
+}
+
+void SearchManager::publish_split_line(size_t idx, Depth depth, const RootMove& rm) {
+    std::lock_guard<std::mutex> lock(splitMutex);
+
+    // Several threads of a group search the same line, keep the deepest
+    auto it = splitLines.find(idx);
+    if (it == splitLines.end())
+        splitLines.emplace(idx, SplitLine{depth, rm});
+    else if (depth >= it->second.depth)
+        it->second = SplitLine{depth, rm};
+}
+
+std::vector<SearchManager::SplitLine> SearchManager::split_lines() {
+    std::vector<SplitLine> lines;
+    {
+        std::lock_guard<std::mutex> lock(splitMutex);
+        for (auto&& [idx, line] : splitLines)
+            lines.push_back(line);
+    }
+
+    std::stable_sort(lines.begin(), lines.end(),
+                     [](const SplitLine& a, const SplitLine& b) { return a.rm < b.rm; });
+
+    // Groups see slightly different rankings, so two lines can agree on a move
+    std::vector<SplitLine> unique;
+    for (auto&& line : lines)
+        if (std::none_of(unique.begin(), unique.end(),
+                         [&](const SplitLine& u) { return u.rm.pv[0] == line.rm.pv[0]; }))
+            unique.push_back(line);
+
+    return unique;
+}
+
 // Called in case we have no ponder move before exiting the search,
 // for instance, in case we stop the search during a fail high at root.
 // We try hard to have a ponder move to return to the GUI,
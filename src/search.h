@@ -26,16 +26,22 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "cluster.h"
 #include "history.h"
+#include "mate.h"
 #include "misc.h"
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
 #include "numa.h"
+#include "pawns.h"
 #include "position.h"
 #include "score.h"
 #include "syzygy/tbprobe.h"
@@ -116,8 +122,8 @@ struct LimitsType {
     LimitsType() {
         time[WHITE] = time[BLACK] = inc[WHITE] = inc[BLACK] = npmsec = movetime = TimePoint(0);
         movestogo = depth = mate = perft = infinite = 0;
-        nodes                                       = 0;
-        ponderMode                                  = false;
+        nodes = nps                                 = 0;
+        ponderMode = mainThreadOnly                 = false;
     }
 
     bool use_time_management() const { return time[WHITE] || time[BLACK]; }
@@ -125,8 +131,8 @@ struct LimitsType {
     std::vector<std::string> searchmoves;
     TimePoint                time[COLOR_NB], inc[COLOR_NB], npmsec, movetime, startTime;
     int                      movestogo, depth, mate, perft, infinite;
-    uint64_t                 nodes;
-    bool                     ponderMode;
+    uint64_t                 nodes, nps;
+    bool                     ponderMode, mainThreadOnly;
 };
 
 
@@ -136,16 +142,19 @@ struct SharedState {
     SharedState(const OptionsMap&                                         optionsMap,
                 ThreadPool&                                               threadPool,
                 TranspositionTable&                                       transpositionTable,
-                const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& nets) :
+                const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& nets,
+                Distributed::Node&                                        clusterNode) :
         options(optionsMap),
         threads(threadPool),
         tt(transpositionTable),
-        networks(nets) {}
+        networks(nets),
+        cluster(clusterNode) {}
 
     const OptionsMap&                                         options;
     ThreadPool&                                               threads;
     TranspositionTable&                                       tt;
     const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& networks;
+    Distributed::Node&                                        cluster;
 };
 
 class Worker;
@@ -204,12 +213,44 @@ struct Skill {
     }
     bool enabled() const { return level < 20.0; }
     bool time_to_pick(Depth depth) const { return depth == 1 + int(level); }
+
+    // Search effort the level can make use of: the move is picked at depth
+    // 1 + level, and the nodes double every two levels (1k at level 0).
+    Depth    max_depth() const { return 1 + int(level); }
+    uint64_t max_nodes() const { return uint64_t(1024) << (int(level) / 2); }
     Move pick_best(const RootMoves&, size_t multiPV);
 
     double level;
     Move   best = Move::none();
 };
 
+// Work of syzygy_extend_pv() kept for the duration of a search. The same
+// lines are shown on every info update and mostly repeat between iterations,
+// so complete results are kept by PV and TB rankings by position.
+struct SyzygyPvCache {
+    static constexpr size_t MaxEntries = 1 << 16;
+
+    struct Ranking {
+        Tablebases::Config config;
+        RootMoves          moves;
+    };
+
+    struct Line {
+        std::vector<Move> pv;
+        Value             v;
+    };
+
+    std::unordered_map<Key, Ranking> rankings;    // Validation of the search PV
+    std::unordered_map<Key, Move>    extensions;  // Next move towards mate, or none
+    std::unordered_map<Key, Line>    lines;       // By root move PV and score
+
+    void clear() {
+        rankings.clear();
+        extensions.clear();
+        lines.clear();
+    }
+};
+
 // SearchManager manages the search from the main thread. It is responsible for
 // keeping track of the time, and storing data strictly related to the main thread.
 class SearchManager: public ISearchManager {
@@ -232,21 +273,41 @@ class SearchManager: public ISearchManager {
 
     void check_time(Search::Worker& worker) override;
 
+    // Root-parallel MultiPV ("MultiPV Split"): each line is searched by one
+    // group of threads, which publish their results here. split_lines()
+    // returns the deepest result of every line, best first, without duplicates.
+    struct SplitLine {
+        Depth    depth;
+        RootMove rm;
+    };
+
+    void                   clear_split_lines();
+    void                   publish_split_line(size_t idx, Depth depth, const RootMove& rm);
+    std::vector<SplitLine> split_lines();
+
     void pv(Search::Worker&           worker,
             const ThreadPool&         threads,
             const TranspositionTable& tt,
             Depth                     depth);
 
-    Hypnos::TimeManagement tm;
-    double                    originalTimeAdjust;
-    int                       callsCnt;
-    std::atomic_bool          ponder;
+    Hypnos::TimeManagement      tm;
+    std::unique_ptr<TimePolicy> timePolicy;
+    double                      originalTimeAdjust;
+    int                         callsCnt;
+    std::atomic_bool            ponder;
 
     std::array<Value, 4> iterValue;
     double               previousTimeReduction;
     Value                bestPreviousScore;
     Value                bestPreviousAverageScore;
     bool                 stopOnPonderhit;
+    bool                 splitActive = false;
+
+    std::mutex                  splitMutex;
+    std::map<size_t, SplitLine> splitLines;
+
+    SyzygyPvCache syzygyPvCache;
+    Mate::Solver  mateSolver;
 
     size_t id;
 
@@ -278,6 +339,9 @@ class Worker {
 
     void ensure_network_replicated();
 
+    uint64_t            nodes_searched() const { return nodes.load(std::memory_order_relaxed); }
+    const Pawns::Table& pawn_table() const { return pawnTable; }
+
     // Public because they need to be updatable by the stats
     ButterflyHistory mainHistory;
     LowPlyHistory    lowPlyHistory;
@@ -295,6 +359,14 @@ class Worker {
 
    private:
     void iterative_deepening();
+    bool search_aborted() const;
+
+    // Searches a single root move to a reduced depth, for Random Open Mode
+    Value search_root_move(Move m, Depth depth, Value alpha, Value beta, std::vector<Move>& pv);
+    void  check_verify_limit();
+
+    // Tries to prove "go mate N" with the proof-number solver, see mate.h
+    bool solve_mate();
 
     void do_move(Position& pos, const Move move, StateInfo& st, Stack* const ss);
     void
@@ -328,6 +400,14 @@ class Worker {
 
     size_t                pvIdx, pvLast;
     std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
+    std::atomic<uint16_t> iterationBestMove;
+    std::atomic<size_t>   speculativeRoot{0};  // 1-based index while pondering another root
+
+    // Bound of a Random Open verification search, checked by every thread
+    // running one. verifyNodes is 0 outside of it.
+    uint64_t  verifyNodes = 0;
+    TimePoint verifyDeadline;
+    int       verifyCalls;
     int                   selDepth, nmpMinPly;
 
     Value optimism[COLOR_NB];
@@ -362,11 +442,15 @@ class Worker {
     ThreadPool&                                               threads;
     TranspositionTable&                                       tt;
     const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& networks;
+    Distributed::Node&                                        cluster;
 
     // Used by NNUE
     Eval::NNUE::AccumulatorStack  accumulatorStack;
     Eval::NNUE::AccumulatorCaches refreshTable;
 
+    // Pawn-only handcrafted eval terms
+    Pawns::Table pawnTable;
+
     friend class Hypnos::ThreadPool;
     friend class SearchManager;
 };
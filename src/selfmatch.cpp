@@ -0,0 +1,508 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "selfmatch.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "bitboard.h"
+#include "engine.h"
+#include "misc.h"
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+#include "syzygy/tbprobe.h"
+#include "tune.h"
+#include "uci.h"
+#include "ucioption.h"
+
+#if defined(HYP_FIXED_ZOBRIST)
+    #include "experience_compat.h"  // The engines we create redirect Experience::g_options
+#endif
+
+namespace Hypnos::SelfMatch {
+
+namespace {
+
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+double elo_to_score(double elo) { return 1 / (1 + std::pow(10, -elo / 400)); }
+
+double score_to_elo(double score) {
+    score = std::clamp(score, 1e-6, 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+// Wins, draws and losses of the first player
+struct Stats {
+    int wins = 0, draws = 0, losses = 0;
+
+    int    games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + draws / 2.0) / games() : 0.5; }
+
+    double variance() const {
+        const double s = score();
+        return games() ? (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s)
+                           / games()
+                       : 0;
+    }
+
+    // Log-likelihood ratio of H1 (elo1) against H0 (elo0), in the usual
+    // normal approximation of the trinomial model
+    double llr(double elo0, double elo1) const {
+        const double var = variance();
+        if (var <= 0)
+            return 0;
+
+        const double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+        return games() * (s1 - s0) * (2 * score() - s0 - s1) / (2 * var);
+    }
+
+    Stats& operator+=(const Stats& o) {
+        wins += o.wins, draws += o.draws, losses += o.losses;
+        return *this;
+    }
+};
+
+// SPRT with alpha = beta = 0.05
+const double LowerBound = std::log(0.05 / 0.95);
+const double UpperBound = -LowerBound;
+
+std::string summary(const Stats& st, const Config& config) {
+    const double s      = st.score();
+    const double margin = 1.96 * std::sqrt(st.variance() / std::max(1, st.games()));
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << "games " << st.games() << " W " << st.wins << " D "
+       << st.draws << " L " << st.losses << " elo " << score_to_elo(s) << " +- "
+       << (score_to_elo(s + margin) - score_to_elo(s - margin)) / 2 << std::setprecision(2)
+       << " LLR " << st.llr(config.elo0, config.elo1) << " [" << LowerBound << ", " << UpperBound
+       << "] for elo " << config.elo0 << " vs " << config.elo1;
+
+    return ss.str();
+}
+
+void set_option(OptionsMap& options, const std::string& name, const std::string& value) {
+    std::istringstream is("name " + name + " value " + value);
+    options.setoption(is);
+}
+
+struct Game {
+    std::string              fen;
+    std::vector<std::string> moves;
+    StateListPtr             states;
+    Position                 pos;
+    int                      white;   // Player with the white pieces
+    int                      result;  // Of the white player, once over
+    bool                     over;
+
+    int to_move() const { return pos.side_to_move() == WHITE ? white : 1 - white; }
+
+    void start(const std::string& f, int whitePlayer, int maxPlies) {
+        fen    = f;
+        white  = whitePlayer;
+        over   = false;
+        states = StateListPtr(new std::deque<StateInfo>(1));
+        moves.clear();
+        pos.set(fen, false, &states->back());
+        adjudicate(maxPlies);
+    }
+
+    void play(Move m, int maxPlies) {
+        moves.push_back(UCIEngine::move(m, false));
+        states->emplace_back();
+        pos.do_move(m, states->back());
+        adjudicate(maxPlies);
+    }
+
+    void finish(int whiteResult) {
+        over   = true;
+        result = whiteResult;
+    }
+
+    // Mates and draws by the rules, then the tablebases when they are loaded
+    void adjudicate(int maxPlies) {
+        const int win = pos.side_to_move() == WHITE ? 1 : -1;  // The side to move wins
+
+        if (!MoveList<LEGAL>(pos).size())
+            finish(pos.checkers() ? -win : 0);
+
+        else if (pos.is_draw(MAX_PLY) || int(moves.size()) >= maxPlies
+                 || (!pos.pieces(PAWN) && pos.non_pawn_material() <= BishopValue))
+            finish(0);
+
+        else if (popcount(pos.pieces()) <= Tablebases::MaxCardinality
+                 && !pos.can_castle(ANY_CASTLING))
+        {
+            Tablebases::ProbeState state;
+            const auto             wdl = Tablebases::probe_wdl(pos, &state);
+
+            if (state != Tablebases::FAIL)
+                finish(wdl == Tablebases::WDLWin ? win : wdl == Tablebases::WDLLoss ? -win : 0);
+        }
+    }
+};
+
+// A game in progress and the engines of its two players
+struct Slot {
+    std::unique_ptr<Engine> engines[2];
+    std::string             bestmove[2];
+    Game                    game;
+    bool                    busy = false;
+};
+
+class Runner {
+   public:
+    Runner(const Config& cfg, const std::string& binaryPath, OptionsMap& options);
+
+    // Plays each of 'pairs' openings twice, player 0 using values[0]
+    Stats play(int pairs, const std::vector<int> (&values)[2]);
+
+    size_t slot_count() const { return slots.size(); }
+
+   private:
+    std::string next_opening();
+
+    const Config&                      config;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<std::string>           openings;
+    size_t                             openingIdx = 0;
+    PRNG                               rng;
+};
+
+Runner::Runner(const Config& cfg, const std::string& binaryPath, OptionsMap& options) :
+    config(cfg),
+    rng(now()) {
+
+    if (!config.openings.empty())
+    {
+        std::ifstream file(config.openings);
+
+        // EPD or FEN lines, the move counters being optional
+        for (std::string line; std::getline(file, line);)
+        {
+            std::istringstream       is(line);
+            std::vector<std::string> fields;
+
+            for (std::string f; fields.size() < 6 && is >> f;)
+                fields.push_back(f);
+
+            if (fields.size() < 4)
+                continue;
+
+            auto number   = [](const std::string& f) {
+                return std::all_of(f.begin(), f.end(), [](unsigned char ch) { return std::isdigit(ch); });
+            };
+            const bool counters = fields.size() == 6 && number(fields[4]) && number(fields[5]);
+
+            std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+            openings.push_back(fen + (counters ? " " + fields[4] + " " + fields[5] : " 0 1"));
+        }
+    }
+
+    for (int i = 0; i < config.concurrency; ++i)
+    {
+        auto slot = std::make_unique<Slot>();
+
+        for (int p = 0; p < 2; ++p)
+        {
+            auto& e = slot->engines[p];
+            e       = std::make_unique<Engine>(binaryPath);
+
+            auto& o = e->get_options();
+            set_option(o, "Threads", "1");
+            set_option(o, "Hash", std::to_string(config.hash));
+            set_option(o, "EvalFile", options["EvalFile"]);
+            set_option(o, "EvalFileSmall", options["EvalFileSmall"]);
+            set_option(o, "Opening Policy", "false");
+            set_option(o, "Experience Readonly", "true");
+
+            e->set_on_verify_networks([](const auto&) {});
+            e->set_on_update_no_moves([](const auto&) {});
+            e->set_on_update_full([](const auto&) {});
+            e->set_on_iter([](const auto&) {});
+            e->set_on_bestmove(
+              [bm = &slot->bestmove[p]](const auto& m, const auto&) { *bm = std::string(m); });
+        }
+
+        slots.push_back(std::move(slot));
+    }
+
+#if defined(HYP_FIXED_ZOBRIST)
+    ::Experience::g_options = &options;
+#endif
+}
+
+// The next opening of the file, or a few random moves from the start position
+std::string Runner::next_opening() {
+    if (!openings.empty())
+        return openings[openingIdx++ % openings.size()];
+
+    while (true)
+    {
+        StateListPtr states(new std::deque<StateInfo>(1));
+        Position     pos;
+        pos.set(StartFEN, false, &states->back());
+
+        for (int i = 0; i < config.plies; ++i)
+        {
+            const MoveList<LEGAL> legal(pos);
+            if (!legal.size())
+                break;
+
+            states->emplace_back();
+            pos.do_move(*(legal.begin() + rng.rand<uint64_t>() % legal.size()), states->back());
+        }
+
+        if (MoveList<LEGAL>(pos).size())
+            return pos.fen();
+    }
+}
+
+Stats Runner::play(int pairs, const std::vector<int> (&values)[2]) {
+    Stats       st;
+    int         started = 0;
+    std::string opening;
+
+    auto record = [&](const Game& g) {
+        const int r = g.white == 0 ? g.result : -g.result;
+        st.wins += r > 0, st.draws += r == 0, st.losses += r < 0;
+    };
+
+    // Both games of an opening are started one after the other
+    auto start_next = [&](Slot& s) {
+        s.busy = false;
+
+        while (!s.busy && started < 2 * pairs)
+        {
+            if (started % 2 == 0)
+                opening = next_opening();
+
+            s.game.start(opening, started++ % 2, config.maxPlies);
+
+            if (s.game.over)
+                record(s.game);
+            else
+                s.busy = true;
+        }
+    };
+
+    for (auto& s : slots)
+        start_next(*s);
+
+    while (std::any_of(slots.begin(), slots.end(), [](const auto& s) { return s->busy; }))
+        for (int player : {0, 1})
+        {
+            Tune::set_values(values[player]);
+
+            std::vector<Slot*> moving;
+
+            for (auto& s : slots)
+                if (s->busy && s->game.to_move() == player)
+                {
+                    Search::LimitsType limits;
+                    limits.startTime = now();
+                    limits.nodes     = config.nodes;
+
+                    s->engines[player]->set_position(s->game.fen, s->game.moves);
+                    s->engines[player]->go(limits);
+                    moving.push_back(s.get());
+                }
+
+            for (Slot* s : moving)
+            {
+                s->engines[player]->wait_for_search_finished();
+
+                const Move m = UCIEngine::to_move(s->game.pos, s->bestmove[player]);
+
+                // A missing move would be an engine bug, scored as a loss
+                if (m == Move::none())
+                    s->game.finish(s->game.pos.side_to_move() == WHITE ? -1 : 1);
+                else
+                    s->game.play(m, config.maxPlies);
+
+                if (s->game.over)
+                {
+                    record(s->game);
+                    start_next(*s);
+                }
+            }
+        }
+
+    return st;
+}
+
+void match(Runner& runner, const Config& config, const std::vector<Tune::Param>& params,
+           const std::function<void(const std::string&)>& report) {
+    std::vector<int> values[2];
+
+    for (const auto& p : params)
+        values[0].push_back(p.value), values[1].push_back(p.defaultValue);
+
+    report(params.empty() ? "selfmatch: no tuned parameters, both players are the same"
+                          : "selfmatch: current values of " + std::to_string(params.size())
+                              + " tuned parameters against their defaults");
+
+    const int batch = std::max(1, int(runner.slot_count()) / 2);
+    Stats     total;
+
+    while (total.games() < config.games)
+    {
+        total += runner.play(std::min(batch, (config.games - total.games() + 1) / 2), values);
+        report("selfmatch " + summary(total, config));
+
+        const double llr = total.llr(config.elo0, config.elo1);
+        if (llr <= LowerBound || llr >= UpperBound)
+        {
+            report(std::string("selfmatch: SPRT accepts ") + (llr >= UpperBound ? "H1" : "H0"));
+            break;
+        }
+    }
+}
+
+// SPSA with the gains used by fishtest: c_end is a twentieth of the range and
+// r_end 0.002, as printed by Tune for each option
+void spsa(Runner& runner, const Config& config, OptionsMap& options,
+          const std::vector<Tune::Param>& params,
+          const std::function<void(const std::string&)>& report) {
+    const int    n = config.spsa, batch = std::max(1, int(runner.slot_count()) / 2);
+    const double A = 0.1 * n, alpha = 0.602, gamma = 0.101;
+
+    std::vector<double> theta, a, c;
+    for (const auto& p : params)
+    {
+        const double cEnd = std::max(1.0, (p.max - p.min) / 20.0);
+        theta.push_back(p.value);
+        c.push_back(cEnd * std::pow(n, gamma));
+        a.push_back(0.002 * cEnd * cEnd * std::pow(A + n, alpha));
+    }
+
+    PRNG  rng(now());
+    Stats total;
+
+    for (int k = 0; k < n; ++k)
+    {
+        std::vector<int> values[2], flip;
+
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            const double ck = c[i] / std::pow(k + 1, gamma);
+            flip.push_back(rng.rand<uint64_t>() & 1 ? 1 : -1);
+
+            for (int p = 0; p < 2; ++p)
+                values[p].push_back(std::clamp(int(std::lround(theta[i] + (p ? -ck : ck) * flip[i])),
+                                               params[i].min, params[i].max));
+        }
+
+        const Stats st     = runner.play(batch, values);
+        const int   result = st.wins - st.losses;
+        total += st;
+
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            const double ck = c[i] / std::pow(k + 1, gamma);
+            const double ak = a[i] / std::pow(A + k + 1, alpha);
+            theta[i] = std::clamp(theta[i] + ak / ck * result * flip[i], double(params[i].min),
+                                  double(params[i].max));
+        }
+
+        report("selfmatch spsa iteration " + std::to_string(k + 1) + "/" + std::to_string(n)
+               + " result " + std::to_string(result) + ", " + summary(total, config));
+    }
+
+    // The tuned values become the current ones
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        const int v = int(std::lround(theta[i]));
+        set_option(options, params[i].name, std::to_string(v));
+        report("selfmatch spsa " + params[i].name + " " + std::to_string(params[i].value) + " -> "
+               + std::to_string(v));
+    }
+}
+
+}  // namespace
+
+Config parse(std::istream& is) {
+    Config      config;
+    std::string token;
+
+    config.concurrency = std::max(1, int(std::thread::hardware_concurrency()));
+
+    while (is >> token)
+        if (token == "games")
+            is >> config.games;
+        else if (token == "nodes")
+            is >> config.nodes;
+        else if (token == "concurrency")
+            is >> config.concurrency;
+        else if (token == "hash")
+            is >> config.hash;
+        else if (token == "openings")
+            is >> config.openings;
+        else if (token == "plies")
+            is >> config.plies;
+        else if (token == "maxplies")
+            is >> config.maxPlies;
+        else if (token == "sprt")
+            is >> config.elo0 >> config.elo1;
+        else if (token == "spsa")
+            is >> config.spsa;
+
+    config.concurrency = std::max(1, config.concurrency);
+    return config;
+}
+
+void run(const Config&                                  config,
+         const std::string&                             binaryPath,
+         OptionsMap&                                    options,
+         const std::function<void(const std::string&)>& report) {
+    const auto      params = Tune::parameters();
+    const TimePoint start  = now();
+
+    if (config.spsa > 0 && params.empty())
+    {
+        report("selfmatch: no tuned parameters, mark some with TUNE() first");
+        return;
+    }
+
+    {
+        Runner runner(config, binaryPath, options);
+
+        if (config.spsa > 0)
+            spsa(runner, config, options, params, report);
+        else
+            match(runner, config, params, report);
+    }
+
+    // Both players left their values in place, restore the options' ones
+    Tune::read_options();
+
+    report("selfmatch done in " + std::to_string((now() - start) / 1000) + " s");
+}
+
+}  // namespace Hypnos::SelfMatch
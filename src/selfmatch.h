@@ -0,0 +1,69 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SELFMATCH_H_INCLUDED
+#define SELFMATCH_H_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+namespace Hypnos {
+
+class OptionsMap;
+
+namespace SelfMatch {
+
+// Fixed-node games between two sets of Tune parameters inside this process,
+// on pairs of Engine instances with one thread each. The parameters are
+// globals, so the games are played in lock-step: all the moves of the first
+// player are searched together with its values in place, then all the moves
+// of the second one. Each opening is played twice with the colors swapped.
+//
+// Without "spsa" the current values of the tuned options play against their
+// defaults, until "games" or an SPRT bound is reached. With "spsa <n>", n
+// iterations of SPSA are run, each on one game pair per slot, and the tuned
+// values are written back to the options.
+struct Config {
+    int         games       = 1000;
+    uint64_t    nodes       = 10000;
+    int         concurrency = 1;
+    int         hash        = 16;
+    int         plies       = 8;    // Random plies of the generated openings
+    int         maxPlies    = 400;  // Longer games are adjudicated as draws
+    int         spsa        = 0;    // SPSA iterations, 0 for a match
+    double      elo0 = 0, elo1 = 5;
+    std::string openings;           // EPD/FEN file, generated openings if empty
+};
+
+// "selfmatch [games <n>] [nodes <n>] [concurrency <n>] [hash <mb>]
+//            [openings <file>] [plies <n>] [sprt <elo0> <elo1>] [spsa <n>]"
+Config parse(std::istream& is);
+
+void run(const Config&                                  config,
+         const std::string&                             binaryPath,
+         OptionsMap&                                    options,
+         const std::function<void(const std::string&)>& report);
+
+}  // namespace SelfMatch
+
+}  // namespace Hypnos
+
+#endif  // #ifndef SELFMATCH_H_INCLUDED
@@ -324,6 +324,8 @@ class SharedMemoryBackend {
             return;
         }
 
+        memory_track(pMap, total_size);
+
         // Use named mutex to ensure only one initializer
         std::string mutex_name = shm_name + "$mutex";
         HANDLE      hMutex     = CreateMutexA(NULL, FALSE, mutex_name.c_str());
@@ -377,6 +379,7 @@ class SharedMemoryBackend {
     void cleanup_partial() {
         if (pMap != nullptr)
         {
+            memory_untrack(pMap);
             UnmapViewOfFile(pMap);
             pMap = nullptr;
         }
@@ -390,6 +393,7 @@ class SharedMemoryBackend {
     void cleanup() {
         if (pMap != nullptr)
         {
+            memory_untrack(pMap);
             UnmapViewOfFile(pMap);
             pMap = nullptr;
         }
@@ -533,6 +537,9 @@ struct SystemWideSharedConstant {
     // Content is addressed by its hash. An additional discriminator can be added to account for differences
     // that are not present in the content, for example NUMA node allocation.
     SystemWideSharedConstant(const T& value, std::size_t discriminator = 0) {
+        // Only the networks are shared this way, account both backends to them
+        MemoryTagScope memoryTag(MemoryTag::Network);
+
         std::size_t content_hash    = std::hash<T>{}(value);
         std::size_t executable_hash = std::hash<std::string>{}(getExecutablePathHash());
 
@@ -42,6 +42,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "memory.h"
+
 #if defined(__NetBSD__) || defined(__DragonFly__) || defined(__linux__)
     #include <limits.h>
     #define SF_MAX_SEM_NAME_LEN NAME_MAX
@@ -394,6 +396,7 @@ class SharedMemory: public detail::SharedMemoryBase {
     void unmap_region() noexcept {
         if (mapped_ptr_)
         {
+            memory_untrack(mapped_ptr_);
             munmap(mapped_ptr_, total_size_);
             mapped_ptr_ = nullptr;
             data_ptr_   = nullptr;
@@ -595,6 +598,8 @@ class SharedMemory: public detail::SharedMemoryBase {
             return false;
         }
 
+        memory_track(mapped_ptr_, total_size_);
+
         data_ptr_ = static_cast<T*>(mapped_ptr_);
         header_ptr_ =
           reinterpret_cast<detail::ShmHeader*>(static_cast<char*>(mapped_ptr_) + sizeof(T));
@@ -628,6 +633,8 @@ class SharedMemory: public detail::SharedMemoryBase {
             return false;
         }
 
+        memory_track(mapped_ptr_, total_size_);
+
         data_ptr_   = static_cast<T*>(mapped_ptr_);
         header_ptr_ = std::launder(
           reinterpret_cast<detail::ShmHeader*>(static_cast<char*>(mapped_ptr_) + sizeof(T)));
@@ -0,0 +1,156 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace Hypnos::Snapshot {
+
+namespace {
+
+constexpr std::uint64_t Magic = 0x50414e5350594800ULL;  // "\0HYPSNAP"
+
+// Large enough to keep the disk busy, small enough to stay in cache while hashing
+constexpr std::size_t ChunkSize = 1 << 22;
+
+struct Header {
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t blockCount;
+    std::uint64_t netHash;
+    std::uint64_t payloadSize;
+    std::uint64_t checksum;
+};
+
+std::uint64_t payload_size(const std::vector<Block>& blocks) {
+    std::uint64_t size = 0;
+    for (const Block& b : blocks)
+        size += b.size;
+    return size;
+}
+
+// Hashes a chunk and folds it into the running checksum. Writer and reader
+// split the blocks into the same chunks, so the boundaries need not align.
+std::uint64_t update_checksum(std::uint64_t h, const char* p, std::size_t n) {
+    constexpr std::uint64_t Mul = 0x9E3779B97F4A7C15ULL;
+
+    std::uint64_t c = n;
+    std::size_t   i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        std::uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        c = (c ^ w) * Mul;
+        c ^= c >> 29;
+    }
+
+    for (; i < n; ++i)
+        c = (c ^ std::uint8_t(p[i])) * Mul;
+
+    h = (h ^ c) * Mul;
+    return h ^ (h >> 32);
+}
+
+}  // namespace
+
+const char* to_string(ReadResult r) {
+    switch (r)
+    {
+    case ReadResult::Ok :
+        return "ok";
+    case ReadResult::Missing :
+        return "file missing";
+    case ReadResult::BadHeader :
+        return "not a snapshot of this version";
+    case ReadResult::WrongNetwork :
+        return "saved with a different network";
+    case ReadResult::WrongSize :
+        return "size does not match the current settings";
+    case ReadResult::BadChecksum :
+        return "checksum mismatch";
+    }
+    return "";
+}
+
+bool write_file(const std::string& path, std::uint64_t netHash, const std::vector<Block>& blocks) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        return false;
+
+    Header header{Magic, Version, std::uint32_t(blocks.size()), netHash, payload_size(blocks), 0};
+
+    // The checksum is only known at the end, the header is rewritten then
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const Block& b : blocks)
+        for (std::size_t off = 0; off < b.size; off += ChunkSize)
+        {
+            const char*       p = static_cast<const char*>(b.data) + off;
+            const std::size_t n = std::min(ChunkSize, b.size - off);
+
+            header.checksum = update_checksum(header.checksum, p, n);
+            out.write(p, std::streamsize(n));
+        }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+
+    return bool(out);
+}
+
+ReadResult
+read_file(const std::string& path, std::uint64_t netHash, const std::vector<Block>& blocks) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return ReadResult::Missing;
+
+    Header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != Magic
+        || header.version != Version)
+        return ReadResult::BadHeader;
+
+    if (header.netHash != netHash)
+        return ReadResult::WrongNetwork;
+
+    if (header.blockCount != blocks.size() || header.payloadSize != payload_size(blocks))
+        return ReadResult::WrongSize;
+
+    std::uint64_t checksum = 0;
+
+    for (const Block& b : blocks)
+        for (std::size_t off = 0; off < b.size; off += ChunkSize)
+        {
+            char*             p = static_cast<char*>(b.data) + off;
+            const std::size_t n = std::min(ChunkSize, b.size - off);
+
+            if (!in.read(p, std::streamsize(n)))
+                return ReadResult::WrongSize;
+
+            checksum = update_checksum(checksum, p, n);
+        }
+
+    return checksum == header.checksum ? ReadResult::Ok : ReadResult::BadChecksum;
+}
+
+}  // namespace Hypnos::Snapshot
@@ -0,0 +1,64 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary files used by the 'snapshot' command to carry the transposition
+// table and the worker histories between sessions. Every file starts with a
+// header holding the network hash and a checksum of the payload, which is
+// streamed in chunks straight from (or into) the engine's own memory.
+
+namespace Hypnos::Snapshot {
+
+constexpr std::uint32_t Version = 1;
+
+// A piece of memory stored in a snapshot file, copied byte for byte
+struct Block {
+    void*       data;
+    std::size_t size;
+};
+
+enum class ReadResult {
+    Ok,
+    Missing,
+    BadHeader,
+    WrongNetwork,
+    WrongSize,
+    BadChecksum
+};
+
+const char* to_string(ReadResult r);
+
+// Writes the blocks to 'path' in order. Returns false on I/O errors.
+bool write_file(const std::string& path, std::uint64_t netHash, const std::vector<Block>& blocks);
+
+// Reads 'path' back into the blocks. On any result but Ok the blocks may
+// hold partial data and must be cleared by the caller.
+ReadResult
+read_file(const std::string& path, std::uint64_t netHash, const std::vector<Block>& blocks);
+
+}  // namespace Hypnos::Snapshot
+
+#endif  // #ifndef SNAPSHOT_H_INCLUDED
@@ -37,10 +37,12 @@
 #include <vector>
 
 #include "../bitboard.h"
+#include "../memory.h"
 #include "../misc.h"
 #include "../movegen.h"
 #include "../position.h"
 #include "../search.h"
+#include "../trace.h"
 #include "../types.h"
 #include "../ucioption.h"
 
@@ -290,6 +292,12 @@ class TBFile: public std::ifstream {
 #endif
         uint8_t* data = (uint8_t*) *baseAddress;
 
+#ifndef _WIN32
+        memory_track(data, statbuf.st_size, MemoryTag::Syzygy);
+#else
+        memory_track(data, (uint64_t(size_high) << 32) | size_low, MemoryTag::Syzygy);
+#endif
+
         constexpr uint8_t Magics[][4] = {{0xD7, 0x66, 0x0C, 0xA5}, {0x71, 0xE8, 0x23, 0x5D}};
 
         if (memcmp(data, Magics[type == WDL], 4))
@@ -304,6 +312,8 @@ class TBFile: public std::ifstream {
 
     static void unmap(void* baseAddress, uint64_t mapping) {
 
+        memory_untrack(baseAddress);
+
 #ifndef _WIN32
         munmap(baseAddress, mapping);
 #else
@@ -1227,6 +1237,8 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     if (e.ready.load(std::memory_order_relaxed))  // Recheck under lock
         return e.baseAddress;
 
+    TRACE_SCOPE("tb_cold_map");
+
     // Pieces strings in decreasing order for each color, like ("KPP","KR")
     std::string fname, w, b;
     for (PieceType pt = KING; pt >= PAWN; --pt)
@@ -31,6 +31,7 @@
 #include "search.h"
 #include "syzygy/tbprobe.h"
 #include "timeman.h"
+#include "trace.h"
 #include "types.h"
 #include "uci.h"
 #include "ucioption.h"
@@ -54,6 +55,8 @@ Thread::Thread(Search::SharedState&                    sharedState,
         // the Worker allocation. Ideally we would also allocate the SearchManager
         // here, but that's minor.
         this->numaAccessToken = binder();
+
+        MemoryTagScope memoryTag(MemoryTag::Worker);
         this->worker = make_unique_large_page<Search::Worker>(sharedState, std::move(sm), n,
                                                               this->numaAccessToken);
     });
@@ -124,8 +127,13 @@ void Thread::idle_loop() {
 
         lk.unlock();
 
+        TRACE_INSTANT("thread_wakeup");
+
         if (job)
+        {
+            TRACE_SCOPE("thread_job");
             job();
+        }
     }
 }
 
@@ -148,6 +156,7 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
         threads.clear();
 
         boundThreadToNumaNode.clear();
+        boundThreadToCpu.clear();
     }
 
     const size_t requested = sharedState.options["Threads"];
@@ -168,13 +177,21 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
             if (numaPolicy == "auto")
                 return numaConfig.suggests_binding_threads(requested);
 
-            // numaPolicy == "system", or explicitly set by the user
+            // numaPolicy == "system", "topology", or explicitly set by the user
             return true;
         }();
 
-        boundThreadToNumaNode = doBindThreads
-                                ? numaConfig.distribute_threads_among_numa_nodes(requested)
-                                : std::vector<NumaIndex>{};
+        // With "topology" each thread is pinned to a single processor, spreading
+        // over physical cores and L3 domains first. When the topology can't be
+        // read this degrades to the usual per-node binding.
+        if (doBindThreads && numaPolicy == "topology")
+            boundThreadToCpu = numaConfig.distribute_threads_among_cores(requested);
+
+        if (!boundThreadToCpu.empty())
+            for (CpuIndex c : boundThreadToCpu)
+                boundThreadToNumaNode.push_back(numaConfig.nodeByCpu.at(c));
+        else if (doBindThreads)
+            boundThreadToNumaNode = numaConfig.distribute_threads_among_numa_nodes(requested);
 
         while (threads.size() < requested)
         {
@@ -188,7 +205,10 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
             // from the same NUMA node, because in case of NUMA replicated memory
             // accesses we don't want to trash cache in case the threads get scheduled
             // on the same NUMA node.
-            auto binder = doBindThreads ? OptionalThreadToNumaNodeBinder(numaConfig, numaId)
+            auto binder = !boundThreadToCpu.empty()
+                          ? OptionalThreadToNumaNodeBinder(numaConfig, numaId,
+                                                           boundThreadToCpu[threadId])
+                        : doBindThreads ? OptionalThreadToNumaNodeBinder(numaConfig, numaId)
                                         : OptionalThreadToNumaNodeBinder(numaId);
 
             threads.emplace_back(
@@ -245,7 +265,7 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
 
     main_thread()->wait_for_search_finished();
 
-    main_manager()->stopOnPonderhit = stop = abortedSearch = false;
+    main_manager()->stopOnPonderhit = stop = abortedSearch = speculationOver = false;
     main_manager()->ponder                                 = limits.ponderMode;
 
     increaseDepth = true;
@@ -274,22 +294,79 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
     if (states.get())
         setupStates = std::move(states);  // Ownership transfer, states is now empty
 
+    // Warm start from a speculative search of this position while pondering:
+    // the root moves come in the order found there, with its score statistics.
+    {
+        std::lock_guard<std::mutex> lock(warmMutex);
+        auto                        warm = warmRoots.find(pos.key());
+
+        if (warm != warmRoots.end() && !tbConfig.rootInTB)
+        {
+            const auto& warmMoves = warm->second.second;
+            auto        rank      = [&](const Search::RootMove& rm) {
+                return std::find(warmMoves.begin(), warmMoves.end(), rm.pv[0]) - warmMoves.begin();
+            };
+
+            std::stable_sort(rootMoves.begin(), rootMoves.end(),
+                             [&](const auto& a, const auto& b) { return rank(a) < rank(b); });
+
+            for (auto& rm : rootMoves)
+            {
+                auto w = std::find(warmMoves.begin(), warmMoves.end(), rm.pv[0]);
+                if (w != warmMoves.end())
+                {
+                    rm.averageScore     = w->averageScore;
+                    rm.meanSquaredScore = w->meanSquaredScore;
+                }
+            }
+        }
+
+        warmRoots.clear();
+    }
+
+    rootFen          = pos.fen();
+    rootChess960     = pos.is_chess960();
+    rootMovesAtStart = rootMoves;
+    tbConfigAtStart  = tbConfig;
+
+    // The last threads go to the speculative roots, if any
+    std::vector<size_t> rootOf(threads.size(), 0);
+    for (size_t i = 0, t = threads.size(); i < speculativeRoots.size(); ++i)
+        for (size_t k = 0; k < speculativeRoots[i].threads && t > 1; ++k)
+            rootOf[--t] = i + 1;
+
     // We use Position::set() to set root position across threads. But there are
     // some StateInfo fields (previous, pliesFromNull, capturedPiece) that cannot
     // be deduced from a fen string, so set() clears them and they are set from
     // setupStates->back() later. The rootState is per thread, earlier states are
     // shared since they are read-only.
-    for (auto&& th : threads)
+    for (size_t idx = 0; idx < threads.size(); ++idx)
     {
-        th->run_custom_job([&]() {
+        auto& th = threads[idx];
+        th->run_custom_job([&, idx]() {
             th->worker->limits = limits;
             th->worker->nodes = th->worker->tbHits = th->worker->nmpMinPly =
               th->worker->bestMoveChanges          = 0;
             th->worker->rootDepth = th->worker->completedDepth = 0;
-            th->worker->rootMoves                              = rootMoves;
-            th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
-            th->worker->rootState = setupStates->back();
-            th->worker->tbConfig  = tbConfig;
+            th->worker->speculativeRoot                        = rootOf[idx];
+
+            if (!rootOf[idx])
+            {
+                th->worker->rootMoves = rootMoves;
+                th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
+                th->worker->rootState = setupStates->back();
+                th->worker->tbConfig  = tbConfig;
+                return;
+            }
+
+            const auto& root = speculativeRoots[rootOf[idx] - 1];
+            th->worker->rootPos.set(root.fen, pos.is_chess960(), &th->worker->rootState);
+            th->worker->rootState = root.states->back();
+            th->worker->rootMoves.clear();
+            for (const auto& m : MoveList<LEGAL>(th->worker->rootPos))
+                th->worker->rootMoves.emplace_back(m);
+            th->worker->tbConfig =
+              Tablebases::rank_root_moves(options, th->worker->rootPos, th->worker->rootMoves);
         });
     }
 
@@ -299,6 +376,31 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
     main_thread()->start_searching();
 }
 
+void ThreadPool::set_speculative_roots(std::vector<SpeculativeRoot>&& roots) {
+    main_thread()->wait_for_search_finished();
+    speculativeRoots = std::move(roots);
+}
+
+bool ThreadPool::end_speculation(Search::Worker& worker) {
+    {
+        std::lock_guard<std::mutex> lock(warmMutex);
+        auto&                       warm = warmRoots[worker.rootPos.key()];
+        if (worker.completedDepth >= warm.first)
+            warm = {worker.completedDepth, worker.rootMoves};
+    }
+
+    if (stop)
+        return false;
+
+    worker.speculativeRoot = 0;
+    worker.rootDepth = worker.completedDepth = 0;
+    worker.rootMoves                         = rootMovesAtStart;
+    worker.rootPos.set(rootFen, rootChess960, &worker.rootState);
+    worker.rootState = setupStates->back();
+    worker.tbConfig  = tbConfigAtStart;
+    return true;
+}
+
 Thread* ThreadPool::get_best_thread() const {
 
     Thread* bestThread = threads.front().get();
@@ -307,9 +409,11 @@ Thread* ThreadPool::get_best_thread() const {
     std::unordered_map<Move, int64_t, Move::MoveHash> votes(
       2 * std::min(size(), bestThread->worker->rootMoves.size()));
 
-    // Find the minimum score of all threads
+    // Find the minimum score of all threads. Threads still on a speculative
+    // root searched a different position and don't take part.
     for (auto&& th : threads)
-        minScore = std::min(minScore, th->worker->rootMoves[0].score);
+        if (!th->worker->speculativeRoot)
+            minScore = std::min(minScore, th->worker->rootMoves[0].score);
 
     // Vote according to score and depth, and select the best thread
     auto thread_voting_value = [minScore](Thread* th) {
@@ -317,10 +421,14 @@ Thread* ThreadPool::get_best_thread() const {
     };
 
     for (auto&& th : threads)
-        votes[th->worker->rootMoves[0].pv[0]] += thread_voting_value(th.get());
+        if (!th->worker->speculativeRoot)
+            votes[th->worker->rootMoves[0].pv[0]] += thread_voting_value(th.get());
 
     for (auto&& th : threads)
     {
+        if (th->worker->speculativeRoot)
+            continue;
+
         const auto bestThreadScore = bestThread->worker->rootMoves[0].score;
         const auto newThreadScore  = th->worker->rootMoves[0].score;
 
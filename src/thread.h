@@ -24,8 +24,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "memory.h"
@@ -54,16 +58,34 @@ class OptionalThreadToNumaNodeBinder {
         numaConfig(&cfg),
         numaId(n) {}
 
+    // Binds to a single processor instead of the whole node
+    OptionalThreadToNumaNodeBinder(const NumaConfig& cfg, NumaIndex n, CpuIndex c) :
+        numaConfig(&cfg),
+        numaId(n),
+        cpuId(c) {}
+
     NumaReplicatedAccessToken operator()() const {
-        if (numaConfig != nullptr)
+        if (numaConfig != nullptr && cpuId.has_value())
+            return numaConfig->bind_current_thread_to_cpu(*cpuId);
+        else if (numaConfig != nullptr)
             return numaConfig->bind_current_thread_to_numa_node(numaId);
         else
             return NumaReplicatedAccessToken(numaId);
     }
 
    private:
-    const NumaConfig* numaConfig;
-    NumaIndex         numaId;
+    const NumaConfig*       numaConfig;
+    NumaIndex               numaId;
+    std::optional<CpuIndex> cpuId;
+};
+
+// A position the opponent can reach instead of the pondered one. While pondering
+// with "Ponder Candidates" some helper threads search it, so that the TT and the
+// root move statistics are warm in case it gets played.
+struct SpeculativeRoot {
+    std::string  fen;
+    StateListPtr states;
+    size_t       threads;
 };
 
 // Abstraction of a thread. It contains a pointer to the worker and a native thread.
@@ -131,6 +153,11 @@ class ThreadPool {
     ThreadPool& operator=(ThreadPool&&)      = delete;
 
     void   start_thinking(const OptionsMap&, Position&, StateListPtr&, Search::LimitsType);
+    void   set_speculative_roots(std::vector<SpeculativeRoot>&& roots);
+    bool   speculating() const { return !speculativeRoots.empty(); }
+    // Called by a worker when its speculative search ends. Saves its results
+    // and, unless the search is over, sets it up for the pondered position.
+    bool end_speculation(Search::Worker& worker);
     void   run_on_thread(size_t threadId, std::function<void()> f);
     void   wait_on_thread(size_t threadId);
     size_t num_threads() const;
@@ -148,10 +175,11 @@ class ThreadPool {
     void                   wait_for_search_finished() const;
 
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
+    const std::vector<CpuIndex>& get_bound_thread_cpus() const { return boundThreadToCpu; }
 
     void ensure_network_replicated();
 
-    std::atomic_bool stop, abortedSearch, increaseDepth;
+    std::atomic_bool stop, abortedSearch, increaseDepth, speculationOver;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
     auto begin() noexcept { return threads.begin(); }
@@ -164,6 +192,19 @@ class ThreadPool {
     StateListPtr                         setupStates;
     std::vector<std::unique_ptr<Thread>> threads;
     std::vector<NumaIndex>               boundThreadToNumaNode;
+    std::vector<CpuIndex>                boundThreadToCpu;
+
+    // Root of the current search, for speculative workers joining it
+    std::string        rootFen;
+    bool               rootChess960 = false;
+    Search::RootMoves  rootMovesAtStart;
+    Tablebases::Config tbConfigAtStart;
+
+    std::vector<SpeculativeRoot> speculativeRoots;
+
+    // Root moves of the speculative searches by position, with their depth
+    std::mutex                                         warmMutex;
+    std::map<Key, std::pair<Depth, Search::RootMoves>> warmRoots;
 
     uint64_t accumulate(std::atomic<uint64_t> Search::Worker::* member) const {
 
@@ -19,20 +19,169 @@
 #include "timeman.h"
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "search.h"
 #include "ucioption.h"
 
 namespace Hypnos {
 
+namespace {
+
+// Calibrated values are stored one per line as "<host> <threads> <npmsec>", in
+// a file next to the binary
+constexpr const char* CalibrationFile = "hypnos_nodestime.txt";
+
+std::string calibrationDirectory;
+
+// Share of the measured speed used as npmsec, leaving a margin for positions
+// searched slower than those seen during calibration.
+constexpr std::int64_t CalibrationShare = 70;  // percent
+
+constexpr TimePoint CalibrationMinTime  = 3000;
+constexpr int       CalibrationMinMoves = 3;
+
+TimePoint load_calibration(const std::string& host, std::size_t threads) {
+    std::ifstream file(calibrationDirectory + CalibrationFile);
+    std::string   h;
+    std::size_t   t;
+    TimePoint     npmsec;
+
+    while (file >> h >> t >> npmsec)
+        if (h == host && t == threads)
+            return npmsec;
+
+    return 0;
+}
+
+void save_calibration(const std::string& host, std::size_t threads, TimePoint npmsec) {
+    std::stringstream kept;
+    std::ifstream     in(calibrationDirectory + CalibrationFile);
+    std::string       h;
+    std::size_t       t;
+    TimePoint         n;
+
+    while (in >> h >> t >> n)
+        if (h != host || t != threads)
+            kept << h << ' ' << t << ' ' << n << '\n';
+
+    in.close();
+
+    std::ofstream out(calibrationDirectory + CalibrationFile, std::ios::trunc);
+    out << kept.str() << host << ' ' << threads << ' ' << npmsec << '\n';
+}
+
+}  // namespace
+
+void TimeManagement::set_calibration_directory(const std::string& dir) {
+    calibrationDirectory = dir;
+}
+
 TimePoint TimeManagement::optimum() const { return optimumTime; }
 TimePoint TimeManagement::maximum() const { return maximumTime; }
 
 void TimeManagement::clear() {
     availableNodes = -1;  // When in 'nodes as time' mode
+    pending.valid  = false;
+    last.valid     = false;
+}
+
+void LatencyEstimator::add(TimePoint lost) {
+    samples[next] = lost;
+    next          = (next + 1) % Capacity;
+    count         = std::min(count + 1, Capacity);
+}
+
+TimePoint LatencyEstimator::estimate() const {
+    if (!count)
+        return 0;
+
+    // Weighted percentile: sort by value and walk until the requested share
+    // of the total weight is covered. The newest sample has weight 1.
+    std::array<std::pair<TimePoint, double>, Capacity> weighted;
+    double                                             total = 0, w = 1;
+    for (std::size_t i = 0; i < count; ++i, w *= Decay)
+    {
+        weighted[i] = {samples[(next + Capacity - 1 - i) % Capacity], w};
+        total += w;
+    }
+
+    std::sort(weighted.begin(), weighted.begin() + count);
+
+    double acc = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        if ((acc += weighted[i].second) >= Percentile * total)
+            return weighted[i].first;
+
+    return weighted[count - 1].first;
+}
+
+void TimeManagement::on_bestmove(std::int64_t nodes) {
+    last = pending;
+    if (last.valid)
+        last.elapsed = elapsed_time();
+
+    if (!calibrateMove)
+        return;
+
+    calibrateMove = false;
+
+    // Very short searches are dominated by startup costs, skip them
+    const TimePoint elapsed = elapsed_time();
+    if (elapsed < 50)
+        return;
+
+    calibrationNodes += nodes;
+    calibrationTime += elapsed;
+    calibrationMoves += 1;
+
+    if (calibrationTime < CalibrationMinTime || calibrationMoves < CalibrationMinMoves)
+        return;
+
+    calibratedNpmsec = std::max(
+      TimePoint(1), calibrationNodes * CalibrationShare / 100 / calibrationTime);
+    save_calibration(host_name(), calibrationThreads, calibratedNpmsec);
+
+    sync_cout << "info string nodestime calibrated to " << calibratedNpmsec << " for "
+              << calibrationThreads << " threads" << sync_endl;
+}
+
+// Returns the npmsec to use for this search. When "Auto nodestime" is on and no
+// value is set, the stored calibration for this host and thread count is used.
+// Without one, searches run on the clock and get measured until enough time
+// was sampled. From then on the value is fixed, so results are reproducible.
+// Only searches that stop on their own clock are sampled: pondering and
+// searches without time control also count the time spent waiting for a stop.
+TimePoint TimeManagement::nodes_per_ms(const Search::LimitsType& limits,
+                                       const OptionsMap&         options) {
+    calibrateMove = false;
+
+    if (int(options["nodestime"]) || !options["Auto nodestime"])
+        return TimePoint(options["nodestime"]);
+
+    const std::size_t threads = std::size_t(int(options["Threads"]));
+    if (threads != calibrationThreads)
+    {
+        calibrationThreads = threads;
+        calibrationNodes   = 0;
+        calibrationTime    = 0;
+        calibrationMoves   = 0;
+        calibratedNpmsec   = load_calibration(host_name(), threads);
+    }
+
+    calibrateMove = !calibratedNpmsec && limits.use_time_management() && !limits.ponderMode
+                 && !limits.infinite;
+    return calibratedNpmsec;
 }
 
 void TimeManagement::advance_nodes_time(std::int64_t nodes) {
@@ -49,18 +198,41 @@ void TimeManagement::init(Search::LimitsType& limits,
                           int                 ply,
                           const OptionsMap&   options,
                           double&             originalTimeAdjust) {
-    TimePoint npmsec = TimePoint(options["nodestime"]);
+    TimePoint npmsec = nodes_per_ms(limits, options);
 
     // If we have no time, we don't need to fully initialize TM.
     // startTime is used by movetime and useNodesTime is used in elapsed calls.
     startTime    = limits.startTime;
     useNodesTime = npmsec != 0;
 
+    // Our clock now should read what it read at our previous move, plus the
+    // increment, minus the time we spent searching. Whatever is missing on
+    // top of that got lost in transit. We skip samples across a time control
+    // reset, and pondering, where the clock starts at "ponderhit" and not at "go".
+    if (last.valid && limits.time[us] && last.us == us && last.ply + 2 == ply)
+    {
+        const TimePoint lost = last.time + last.inc - last.elapsed - limits.time[us];
+        lag.add(std::clamp(lost, TimePoint(0), TimePoint(10000)));
+    }
+
+    last.valid    = false;
+    pending.valid = limits.time[us] && !useNodesTime && !limits.ponderMode
+                 && limits.movestogo != 1;
+    pending.us    = us;
+    pending.ply   = ply;
+    pending.time  = limits.time[us];
+    pending.inc   = limits.inc[us];
+
     if (limits.time[us] == 0)
         return;
 
     TimePoint minThinkingTime = TimePoint(options["Minimum Thinking Time"]);
     TimePoint moveOverhead    = TimePoint(options["MoveOverhead"]);
+
+    // With "Adaptive MoveOverhead" the measured loss replaces the configured
+    // value once there are enough samples, with a small safety margin.
+    if (options["Adaptive MoveOverhead"] && lag.size() >= LatencyEstimator::MinSamples)
+        moveOverhead = std::max(TimePoint(1), lag.estimate() * 5 / 4 + 2);
     TimePoint slowMover       = TimePoint(options["Slow Mover"]);
 
     // optScale is a percentage of available time to use for the current move.
@@ -143,4 +315,170 @@ void TimeManagement::init(Search::LimitsType& limits,
         optimumTime += optimumTime / 4;
 }
 
+namespace {
+
+// The policy the engine has been tuned with
+class DefaultTimePolicy: public TimePolicy {
+   public:
+    TimeDecision decide(const IterationStats& s) const override {
+        double fallingEval = (11.85 + 2.24 * (s.bestPreviousAverageScore - s.bestValue)
+                              + 0.93 * (s.iterValue - s.bestValue))
+                           / 100.0;
+        fallingEval = std::clamp(fallingEval, 0.57, 1.70);
+
+        // If the bestMove is stable over several iterations, reduce time accordingly
+        double k      = 0.51;
+        double center = s.lastBestMoveDepth + 12.15;
+
+        double timeReduction = 0.66 + 0.85 / (0.98 + std::exp(-k * (s.depth - center)));
+
+        double reduction = (1.43 + s.previousTimeReduction) / (2.28 * timeReduction);
+
+        double totalTime = s.optimum * fallingEval * reduction * instability(s) * effort(s);
+
+        // Cap used time in case of a single legal move for a better viewer experience
+        if (s.rootMoves == 1)
+            totalTime = std::min(502.0, totalTime);
+
+        return {totalTime, timeReduction};
+    }
+
+   protected:
+    // Share of the nodes spent on the best move, scaled to 100000
+    static std::uint64_t nodes_effort(const IterationStats& s) {
+        return s.bestMoveEffort * 100000 / std::max(std::uint64_t(1), s.nodes);
+    }
+
+    virtual double instability(const IterationStats& s) const {
+        return 1.02 + 2.14 * s.bestMoveChanges / s.threads;
+    }
+
+    virtual double effort(const IterationStats& s) const {
+        return nodes_effort(s) >= 93340 ? 0.76 : 1.0;
+    }
+};
+
+// Stops as soon as nearly all nodes go to the best move, once a minimum share
+// of the optimum time has been used.
+class EffortTimePolicy: public DefaultTimePolicy {
+   public:
+    TimeDecision decide(const IterationStats& s) const override {
+        TimeDecision d = DefaultTimePolicy::decide(s);
+
+        if (nodes_effort(s) >= 97000 && s.elapsed >= s.optimum / 4)
+            d.totalTime = 0;
+
+        return d;
+    }
+};
+
+// Measures instability by how much the threads disagree on the best move,
+// on top of how often it changed.
+class InstabilityTimePolicy: public DefaultTimePolicy {
+   protected:
+    double instability(const IterationStats& s) const override {
+        return 0.9 + 1.2 * (1.0 - s.agreement) + 1.5 * s.bestMoveChanges / s.threads;
+    }
+};
+
+struct LoggedIteration {
+    IterationStats stats;
+    std::string    bestMove;
+};
+
+}  // namespace
+
+std::unique_ptr<TimePolicy> make_time_policy(const std::string& name) {
+    if (name == "effort")
+        return std::make_unique<EffortTimePolicy>();
+    if (name == "instability")
+        return std::make_unique<InstabilityTimePolicy>();
+
+    return std::make_unique<DefaultTimePolicy>();
+}
+
+void log_search_start(std::ostream& log, const std::string& fen) {
+    log << "search " << fen << '\n';
+}
+
+void log_iteration(std::ostream& log, const IterationStats& s, const std::string& bestMove) {
+    log << "iter " << s.depth << ' ' << s.elapsed << ' ' << s.optimum << ' ' << s.maximum << ' '
+        << s.nodes << ' ' << s.bestMoveEffort << ' ' << s.bestValue << ' '
+        << s.bestPreviousAverageScore << ' ' << s.iterValue << ' ' << s.previousTimeReduction
+        << ' ' << s.lastBestMoveDepth << ' ' << s.bestMoveChanges << ' ' << s.threads << ' '
+        << s.rootMoves << ' ' << s.agreement << ' ' << bestMove << '\n';
+}
+
+void replay_time_policies(std::istream& log, std::ostream& out) {
+    std::vector<std::vector<LoggedIteration>> searches;
+
+    for (std::string line; std::getline(log, line);)
+    {
+        std::istringstream is(line);
+        std::string        token;
+        is >> token;
+
+        if (token == "search")
+            searches.emplace_back();
+
+        else if (token == "iter" && !searches.empty())
+        {
+            LoggedIteration it;
+            auto&           s = it.stats;
+            if (is >> s.depth >> s.elapsed >> s.optimum >> s.maximum >> s.nodes >> s.bestMoveEffort
+                >> s.bestValue >> s.bestPreviousAverageScore >> s.iterValue
+                >> s.previousTimeReduction >> s.lastBestMoveDepth >> s.bestMoveChanges
+                >> s.threads >> s.rootMoves >> s.agreement >> it.bestMove)
+                searches.back().push_back(it);
+        }
+    }
+
+    searches.erase(std::remove_if(searches.begin(), searches.end(),
+                                  [](const auto& s) { return s.empty(); }),
+                   searches.end());
+
+    out << "Replaying " << searches.size() << " searches\n"
+        << "policy        time/optimum  same move  censored\n";
+
+    if (searches.empty())
+        return;
+
+    for (const char* name : {"default", "effort", "instability"})
+    {
+        const auto policy = make_time_policy(name);
+        double     timeRatio = 0;
+        size_t     sameMove = 0, censored = 0;
+
+        for (const auto& search : searches)
+        {
+            // A policy that wants to go on after the last logged iteration is
+            // credited with the time and move of that iteration.
+            const LoggedIteration* stop = nullptr;
+            for (const auto& it : search)
+            {
+                const TimeDecision d = policy->decide(it.stats);
+                if (it.stats.elapsed > std::min(d.totalTime, double(it.stats.maximum)))
+                {
+                    stop = &it;
+                    break;
+                }
+            }
+
+            if (!stop)
+            {
+                stop = &search.back();
+                censored += 1;
+            }
+
+            timeRatio += double(stop->stats.elapsed) / std::max(TimePoint(1), stop->stats.optimum);
+            sameMove += stop->bestMove == search.back().bestMove;
+        }
+
+        out << std::left << std::setw(14) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(11) << 100 * timeRatio / searches.size() << "% "
+            << std::setw(9) << 100.0 * sameMove / searches.size() << "% " << std::setw(9)
+            << censored << '\n';
+    }
+}
+
 }  // namespace Hypnos
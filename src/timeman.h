@@ -19,7 +19,12 @@
 #ifndef TIMEMAN_H_INCLUDED
 #define TIMEMAN_H_INCLUDED
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
 
 #include "misc.h"
 
@@ -32,6 +37,67 @@ namespace Search {
 struct LimitsType;
 }
 
+// Inputs of the decision whether to search another iteration, taken by the
+// main thread at the end of each iteration. Scores are in internal units.
+struct IterationStats {
+    TimePoint     elapsed, optimum, maximum;
+    int           depth, lastBestMoveDepth;
+    int           bestValue, bestPreviousAverageScore, iterValue;
+    double        previousTimeReduction, bestMoveChanges;
+    std::size_t   threads, rootMoves;
+    std::uint64_t nodes, bestMoveEffort;
+    double        agreement;  // Share of threads whose last best move is ours
+};
+
+struct TimeDecision {
+    double totalTime;      // Stop once elapsed time exceeds this (or the maximum)
+    double timeReduction;  // Carried over to the next move
+};
+
+// A time policy scales the optimum time by how settled the search looks.
+// Policies are stateless so they can be replayed on logged searches.
+class TimePolicy {
+   public:
+    virtual ~TimePolicy() = default;
+
+    virtual TimeDecision decide(const IterationStats& s) const = 0;
+};
+
+// Names accepted by make_time_policy(), in UCI combo option syntax
+inline constexpr const char* TimePolicyCombo = "default var default var effort var instability";
+
+std::unique_ptr<TimePolicy> make_time_policy(const std::string& name);
+
+// Logging of iterations for offline evaluation of time policies. A search
+// is a "search" line followed by one "iter" line per completed iteration.
+void log_search_start(std::ostream& log, const std::string& fen);
+void log_iteration(std::ostream& log, const IterationStats& s, const std::string& bestMove);
+
+// Replays every policy on a log and reports when each would have stopped and
+// whether it would have played the move found by the deepest logged iteration.
+void replay_time_policies(std::istream& log, std::ostream& out);
+
+// Keeps the most recent samples of time lost per move outside of the search
+// (GUI and network round trip) and estimates a high percentile of them, with
+// older samples weighing less so the estimate follows changes of the link.
+class LatencyEstimator {
+   public:
+    static constexpr std::size_t MinSamples = 4;
+
+    void        add(TimePoint lost);
+    std::size_t size() const { return count; }
+    TimePoint   estimate() const;
+
+   private:
+    static constexpr std::size_t Capacity   = 64;
+    static constexpr double      Decay      = 0.93;
+    static constexpr double      Percentile = 0.9;
+
+    std::array<TimePoint, Capacity> samples{};
+    std::size_t                     next  = 0;
+    std::size_t                     count = 0;
+};
+
 // The TimeManagement class computes the optimal time to think depending on
 // the maximum available time, the game move number, and other parameters.
 class TimeManagement {
@@ -53,6 +119,15 @@ class TimeManagement {
     void clear();
     void advance_nodes_time(std::int64_t nodes);
 
+    // Called when the best move is sent, to measure the time lost until the
+    // next "go" and to calibrate the nodes per millisecond for "Auto nodestime".
+    void on_bestmove(std::int64_t nodes);
+
+    // Directory of the stored "Auto nodestime" calibration, the binary's one
+    static void set_calibration_directory(const std::string& dir);
+
+    const LatencyEstimator& latency() const { return lag; }
+
    private:
     TimePoint startTime;
     TimePoint optimumTime;
@@ -60,6 +135,28 @@ class TimeManagement {
 
     std::int64_t availableNodes = -1;     // When in 'nodes as time' mode
     bool         useNodesTime   = false;  // True if we are in 'nodes as time' mode
+
+    // Clock state of our previous move, to compare against the clock at the
+    // following "go". Only kept when the previous move can be sampled.
+    struct LastMove {
+        bool      valid = false;
+        Color     us;
+        int       ply;
+        TimePoint time, inc, elapsed;
+    };
+
+    LastMove         pending, last;
+    LatencyEstimator lag;
+
+    // "Auto nodestime": calibrated npmsec for the current thread count, or the
+    // totals measured so far while still calibrating
+    TimePoint    nodes_per_ms(const Search::LimitsType& limits, const OptionsMap& options);
+    TimePoint    calibratedNpmsec   = 0;
+    std::size_t  calibrationThreads = 0;
+    std::int64_t calibrationNodes   = 0;
+    TimePoint    calibrationTime    = 0;
+    int          calibrationMoves   = 0;
+    bool         calibrateMove      = false;
 };
 
 }  // namespace Hypnos
@@ -0,0 +1,171 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Hypnos::Trace {
+
+namespace {
+
+static_assert((RingSize & (RingSize - 1)) == 0, "RingSize must be a power of 2");
+
+const auto Epoch = std::chrono::steady_clock::now();
+
+struct Event {
+    const char*  name;
+    std::int64_t ts;
+    std::int64_t dur;
+    char         phase;
+};
+
+// Single producer ring: only the owning thread writes, the dump reads the
+// head with acquire semantics and copies the last RingSize events.
+struct Ring {
+    std::array<Event, RingSize> events;
+    std::atomic<std::uint64_t>  head{0};
+    int                         tid = 0;
+
+    void push(const Event& e) {
+        const std::uint64_t h  = head.load(std::memory_order_relaxed);
+        events[h & (RingSize - 1)] = e;
+        head.store(h + 1, std::memory_order_release);
+    }
+};
+
+std::mutex                         registryMutex;
+std::vector<std::unique_ptr<Ring>> rings;
+std::vector<Ring*>                 freeRings;
+
+// Rings of exited threads go back to the free list so that the thread pool
+// being resized does not grow the registry without bound.
+struct RingHolder {
+    Ring* ring = nullptr;
+
+    ~RingHolder() {
+        if (ring)
+        {
+            std::lock_guard<std::mutex> lk(registryMutex);
+            freeRings.push_back(ring);
+        }
+    }
+};
+
+thread_local RingHolder holder;
+
+Ring& local_ring() {
+    if (!holder.ring)
+    {
+        std::lock_guard<std::mutex> lk(registryMutex);
+        if (!freeRings.empty())
+        {
+            holder.ring = freeRings.back();
+            freeRings.pop_back();
+        }
+        else
+        {
+            rings.push_back(std::make_unique<Ring>());
+            holder.ring      = rings.back().get();
+            holder.ring->tid = int(rings.size());
+        }
+    }
+    return *holder.ring;
+}
+
+void write_escaped(std::ofstream& out, const char* s) {
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            out << '\\';
+        out << *s;
+    }
+}
+
+}  // namespace
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - Epoch)
+      .count();
+}
+
+void instant(const char* name) {
+    if constexpr (Enabled)
+        local_ring().push({name, now_ns(), 0, 'i'});
+}
+
+void complete(const char* name, std::int64_t startNs, std::int64_t endNs) {
+    if constexpr (Enabled)
+        local_ring().push({name, startNs, endNs - startNs, 'X'});
+}
+
+std::int64_t write_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out)
+        return -1;
+
+    std::int64_t count = 0;
+    bool         first = true;
+
+    out << "{\"traceEvents\":[";
+
+    std::lock_guard<std::mutex> lk(registryMutex);
+    for (const auto& ring : rings)
+    {
+        const std::uint64_t head  = ring->head.load(std::memory_order_acquire);
+        const std::uint64_t begin = head > RingSize ? head - RingSize : 0;
+
+        for (std::uint64_t i = begin; i < head; ++i)
+        {
+            const Event& e = ring->events[i & (RingSize - 1)];
+
+            out << (first ? "\n" : ",\n") << "{\"name\":\"";
+            write_escaped(out, e.name);
+            out << "\",\"cat\":\"hypnos\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.ts / 1000
+                << '.' << (e.ts % 1000) / 100 << (e.ts % 100) / 10 << e.ts % 10;
+
+            if (e.phase == 'X')
+                out << ",\"dur\":" << e.dur / 1000 << '.' << (e.dur % 1000) / 100
+                    << (e.dur % 100) / 10 << e.dur % 10;
+            else
+                out << ",\"s\":\"t\"";
+
+            out << ",\"pid\":1,\"tid\":" << ring->tid << "}";
+            first = false;
+            ++count;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out ? count : -1;
+}
+
+void clear() {
+    std::lock_guard<std::mutex> lk(registryMutex);
+    for (const auto& ring : rings)
+        ring->head.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace Hypnos::Trace
@@ -0,0 +1,81 @@
+/*
+  HypnoS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  HypnoS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  HypnoS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lightweight event tracing. When the engine is built with 'make trace=yes'
+// every thread records timestamped events into its own fixed-size ring
+// buffer; the 'trace' UCI command dumps all rings in the Chrome trace_event
+// JSON format, which can be opened with chrome://tracing or Perfetto.
+// Without USE_TRACE the macros below expand to nothing.
+
+namespace Hypnos::Trace {
+
+#ifdef USE_TRACE
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+// Events kept per thread, older ones are overwritten. Must be a power of 2.
+constexpr std::size_t RingSize = 1 << 16;
+
+// Event names must be string literals (only the pointer is stored)
+std::int64_t now_ns();
+void         instant(const char* name);
+void         complete(const char* name, std::int64_t startNs, std::int64_t endNs);
+
+class Scope {
+   public:
+    explicit Scope(const char* n) :
+        name(n),
+        start(now_ns()) {}
+    ~Scope() { complete(name, start, now_ns()); }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char*  name;
+    std::int64_t start;
+};
+
+// Writes all recorded events to 'path' and returns how many were written,
+// or -1 if the file could not be opened.
+std::int64_t write_json(const std::string& path);
+void         clear();
+
+}  // namespace Hypnos::Trace
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#ifdef USE_TRACE
+    #define TRACE_SCOPE(name) Hypnos::Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+    #define TRACE_INSTANT(name) Hypnos::Trace::instant(name)
+#else
+    #define TRACE_SCOPE(name)
+    #define TRACE_INSTANT(name)
+#endif
+
+#endif  // #ifndef TRACE_H_INCLUDED
@@ -157,6 +157,7 @@ void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
 
     clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
+    MemoryTagScope memoryTag(MemoryTag::TT);
     table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
 
     if (!table)
@@ -179,11 +180,8 @@ void TranspositionTable::clear(ThreadPool& threads) {
     {
         threads.run_on_thread(i, [this, i, threadCount]() {
             // Each thread will zero its part of the hash table
-            const size_t stride = clusterCount / threadCount;
-            const size_t start  = stride * i;
-            const size_t len    = i + 1 != threadCount ? stride : clusterCount - start;
-
-            std::memset(&table[start], 0, len * sizeof(Cluster));
+            const auto [data, size] = slice(i, threadCount);
+            std::memset(data, 0, size);
         });
     }
 
@@ -215,6 +213,19 @@ void TranspositionTable::new_search() {
 
 uint8_t TranspositionTable::generation() const { return generation8; }
 
+void TranspositionTable::set_generation(uint8_t g) { generation8 = g; }
+
+
+// Splits the table into n parts of equal size, the last one also takes the
+// remainder. Used to clear, save and restore the table in parallel.
+std::pair<void*, size_t> TranspositionTable::slice(size_t i, size_t n) const {
+    const size_t stride = clusterCount / n;
+    const size_t start  = stride * i;
+    const size_t len    = i + 1 != n ? stride : clusterCount - start;
+
+    return {&table[start], len * sizeof(Cluster)};
+}
+
 
 // Looks up the current position in the transposition
 // table. It returns true if the position is found.
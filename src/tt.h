@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <tuple>
+#include <utility>
 
 #include "memory.h"
 #include "types.h"
@@ -91,6 +92,9 @@ class TranspositionTable {
     void
     new_search();  // This must be called at the beginning of each root search to track entry aging
     uint8_t generation() const;  // The current age, used when writing new data to the TT
+    void    set_generation(uint8_t g);  // Used when restoring a snapshot
+    std::pair<void*, size_t>
+    slice(size_t i, size_t n) const;  // Raw bytes of the i-th of n parts, as cleared by clear()
     std::tuple<bool, TTData, TTWriter>
     probe(const Key key) const;  // The main method, whose retvals separate local vs global objects
     TTEntry* first_entry(const Key key)
@@ -98,6 +98,40 @@ void Tune::Entry<int>::read_option() {
         value = int((*options)[name]);
 }
 
+template<>
+bool Tune::Entry<int>::param(Param& p) const {
+    if (!options->count(name))
+        return false;
+
+    const Option& o = (*options)[name];
+    p               = {name, value, std::stoi(o.defaultValue), o.min, o.max};
+    return true;
+}
+
+template<>
+void Tune::Entry<int>::set_value(std::vector<int>::const_iterator& it) {
+    if (options->count(name))
+        value = *it++;
+}
+
+std::vector<Tune::Param> Tune::parameters() {
+    std::vector<Param> params;
+    Param              p;
+
+    for (auto& e : instance().list)
+        if (e->param(p))
+            params.push_back(p);
+
+    return params;
+}
+
+void Tune::set_values(const std::vector<int>& values) {
+    auto it = values.cbegin();
+
+    for (auto& e : instance().list)
+        e->set_value(it);
+}
+
 // Instead of a variable here we have a PostUpdate function: just call it
 template<>
 void Tune::Entry<Tune::PostUpdate>::init_option() {}
@@ -105,6 +139,14 @@ template<>
 void Tune::Entry<Tune::PostUpdate>::read_option() {
     value();
 }
+template<>
+bool Tune::Entry<Tune::PostUpdate>::param(Param&) const {
+    return false;
+}
+template<>
+void Tune::Entry<Tune::PostUpdate>::set_value(std::vector<int>::const_iterator&) {
+    value();
+}
 
 }  // namespace Hypnos
 
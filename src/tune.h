@@ -78,6 +78,14 @@ struct SetRange {
 
 class Tune {
 
+   public:
+    // A tunable parameter, as exposed through its UCI option
+    struct Param {
+        std::string name;
+        int         value, defaultValue, min, max;
+    };
+
+   private:
     using PostUpdate = void();  // Post-update function
 
     Tune() { read_results(); }
@@ -95,6 +103,8 @@ class Tune {
         virtual ~EntryBase()       = default;
         virtual void init_option() = 0;
         virtual void read_option() = 0;
+        virtual bool param(Param&) const                          = 0;
+        virtual void set_value(std::vector<int>::const_iterator&) = 0;
     };
 
     template<typename T>
@@ -112,6 +122,8 @@ class Tune {
         void operator=(const Entry&) = delete;  // Because 'value' is a reference
         void init_option() override;
         void read_option() override;
+        bool param(Param&) const override;
+        void set_value(std::vector<int>::const_iterator&) override;
 
         std::string name;
         T&          value;
@@ -166,6 +178,12 @@ class Tune {
             e->read_option();
     }
 
+    // The parameters that have an option, and assigning them all at once
+    // in that order, running the post-update functions. Used by the
+    // in-process tuner, which switches the values between two players.
+    static std::vector<Param> parameters();
+    static void               set_values(const std::vector<int>& values);
+
     static bool        update_on_last;
     static OptionsMap* options;
 };
@@ -22,7 +22,11 @@
 #include <cctype>
 #include <cmath>
 #include <cstdint>
+#include <deque>
+#include <fstream>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string_view>
@@ -34,9 +38,13 @@
 #include "experience.h"
 #include "memory.h"
 #include "movegen.h"
+#include "pgn.h"
 #include "position.h"
 #include "score.h"
 #include "search.h"
+#include "selfmatch.h"
+#include "timeman.h"
+#include "trace.h"
 #include "types.h"
 #include "ucioption.h"
 
@@ -345,6 +353,29 @@ void UCIEngine::loop() {
                 Experience::merge((int)cargs.size(), cargs.data());
             }
         }
+        else if (token == "export_journal" || token == "import_journal")
+        {
+            // Both change the loaded experience, which the search threads read
+            engine.wait_for_search_finished();
+            ensure_exp_initialized(engine);
+            Experience::wait_for_loading_finished();
+
+            // Syntax: export_journal <delta file>
+            //         import_journal <delta file> [target.exp]
+            std::vector<std::string> args;
+            for (std::string a; is >> std::skipws >> a; )
+                args.emplace_back(std::move(a));
+
+            std::vector<char*> cargs;
+            cargs.reserve(args.size());
+            for (auto& s : args)
+                cargs.push_back(const_cast<char*>(s.c_str()));
+
+            if (token == "export_journal")
+                Experience::export_journal((int)cargs.size(), cargs.data());
+            else
+                Experience::import_journal((int)cargs.size(), cargs.data());
+        }
         else if (token == "import_cpgn")
         {
             ensure_exp_initialized(engine);
@@ -458,6 +489,83 @@ void UCIEngine::loop() {
             std::cout << std::endl;
             sync_cout_end();
         }
+        else if (token == "timereplay") {
+            // Non-UCI debug command: evaluate the time policies on a file
+            // written with the "Time Log File" option.
+            std::string file;
+            is >> std::skipws >> file;
+
+            std::ifstream log(file);
+            if (!log)
+                sync_cout << "info string Could not open time log " << file << sync_endl;
+            else
+            {
+                std::stringstream ss;
+                replay_time_policies(log, ss);
+
+                std::string report = ss.str();
+                report.pop_back();  // Trailing newline, sync_endl adds one
+                sync_cout << report << sync_endl;
+            }
+        }
+        else if (token == "snapshot") {
+            // Non-UCI command: "snapshot save|load <dir>" keeps the TT, the
+            // histories and the position between analysis sessions
+            std::string action, dir;
+            is >> std::skipws >> action >> dir;
+
+            if ((action != "save" && action != "load") || dir.empty())
+                sync_cout << "info string Usage: snapshot save|load <dir>" << sync_endl;
+            else
+                print_info_string(action == "save" ? engine.save_snapshot(dir)
+                                                   : engine.load_snapshot(dir));
+        }
+        else if (token == "selfmatch")
+        {
+            // Non-UCI command: in-process fixed-node match or SPSA session
+            engine.wait_for_search_finished();
+            SelfMatch::run(SelfMatch::parse(is), cli.argv[0], engine.get_options(),
+                           [](const std::string& s) { print_info_string(s); });
+        }
+        else if (token == "cluster")
+            // Non-UCI command: peers and traffic of the cluster node
+            print_info_string(engine.cluster_status());
+        else if (token == "analyse_game")
+            analyse_game(is);
+        else if (token == "memory") {
+            // Non-UCI debug command: memory usage per subsystem
+            print_info_string(engine.memory_information_as_string());
+        }
+        else if (token == "trace") {
+            // Non-UCI debug command: dump the per-thread event rings.
+            // Format: "trace [clear | <file>]" (default file: hypnos_trace.json)
+            if (!Trace::Enabled)
+                sync_cout << "info string Tracing is not compiled in, rebuild with 'make trace=yes'"
+                          << sync_endl;
+            else
+            {
+                std::string arg = "hypnos_trace.json";
+                is >> std::skipws >> arg;
+
+                // The rings are only read consistently while the threads are idle
+                engine.wait_for_search_finished();
+
+                if (arg == "clear")
+                {
+                    Trace::clear();
+                    sync_cout << "info string Trace buffers cleared" << sync_endl;
+                }
+                else
+                {
+                    const std::int64_t n = Trace::write_json(arg);
+                    if (n < 0)
+                        sync_cout << "info string Could not write trace file " << arg << sync_endl;
+                    else
+                        sync_cout << "info string Wrote " << n << " trace events to " << arg
+                                  << sync_endl;
+                }
+            }
+        }
         else if (!token.empty() && token[0] != '#') {
             sync_cout << "Unknown command: '" << cmd
                       << "'. Type help for more information." << sync_endl;
@@ -533,6 +641,7 @@ void UCIEngine::bench(std::istream& args) {
     std::string token;
     uint64_t    num, nodes = 0, cnt = 1;
     uint64_t    nodesSearched = 0;
+    std::vector<uint64_t> threadNodes;
 													 
 
     engine.set_on_update_full([&](const auto& i) {
@@ -545,6 +654,8 @@ void UCIEngine::bench(std::istream& args) {
     num = count_if(list.begin(), list.end(),
                    [](const std::string& s) { return s.find("go ") == 0 || s.find("eval") == 0; });
 
+    std::vector<std::string> fens;
+
     TimePoint elapsed = now();
 
     for (const auto& cmd : list)
@@ -556,6 +667,7 @@ void UCIEngine::bench(std::istream& args) {
         {
             std::cerr << "\nPosition: " << cnt++ << '/' << num << " (" << engine.fen() << ")"
                       << std::endl;
+            fens.push_back(engine.fen());
             if (token == "go")
             {
                 Search::LimitsType limits = parse_limits(is);
@@ -566,6 +678,11 @@ void UCIEngine::bench(std::istream& args) {
                 {
                     engine.go(limits);
                     engine.wait_for_search_finished();
+
+                    const auto perThread = engine.nodes_per_thread();
+                    threadNodes.resize(perThread.size());
+                    for (size_t i = 0; i < perThread.size(); ++i)
+                        threadNodes[i] += perThread[i];
                 }
 
                 nodes += nodesSearched;
@@ -594,6 +711,25 @@ void UCIEngine::bench(std::istream& args) {
               << "\nNodes searched  : " << nodes    //
               << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
 
+    // Threads that fall behind the others show up here, e.g. on a remote NUMA node
+    if (threadNodes.size() > 1)
+    {
+        std::cerr << "Nodes/second per thread :";
+        for (uint64_t n : threadNodes)
+            std::cerr << " " << 1000 * n / elapsed;
+        std::cerr << std::endl;
+    }
+
+    // Counted since the last "ucinewgame" of the list, which clears the tables
+    // of the threads it set up
+    const auto [pawnHits, pawnProbes] = engine.pawn_table_stats();
+
+    std::cerr << "Pawn table hits : " << (pawnProbes ? 100 * pawnHits / pawnProbes : 0) << "% of "
+              << pawnProbes << " probes" << std::endl;
+
+    if (engine.get_options()["NNUE Int8 PSQ"])
+        std::cerr << "Int8 PSQ drift  : " << engine.psq_int8_drift(fens) << std::endl;
+
 #if defined(HYP_FIXED_ZOBRIST)
     // Bench mode OFF
     Experience::g_benchMode.store(false, std::memory_order_relaxed);
@@ -776,6 +912,250 @@ void UCIEngine::benchmark(std::istream& args) {
 #endif
 }
 
+namespace {
+
+// Scores of the game analysis in centipawns from the side to move, with mates
+// mapped beyond any normal evaluation so that they compare correctly.
+constexpr int AnalysisMateCp  = 30000;
+constexpr int AnalysisLossCap = 1000;
+constexpr int AnalysisNoScore = std::numeric_limits<int>::min();  // No search result
+
+int analysis_cp(const Score& s) {
+    constexpr int TB_CP = 20000;
+    return s.visit(overload{
+      [](Score::Mate mate) { return mate.plies > 0 ? AnalysisMateCp - mate.plies
+                                                   : -AnalysisMateCp - mate.plies; },
+      [](Score::Tablebase tb) { return tb.win ? TB_CP - tb.plies : -TB_CP - tb.plies; },
+      [](Score::InternalUnits units) { return units.value; }});
+}
+
+std::string analysis_score(int cp) {
+    std::ostringstream ss;
+
+    if (cp == AnalysisNoScore)
+        ss << "-";
+    else if (std::abs(cp) > AnalysisMateCp - MAX_PLY)
+    {
+        const int plies = AnalysisMateCp - std::abs(cp);
+        ss << (cp > 0 ? "#" : "#-") << (plies + 1) / 2;
+    }
+    else
+        ss << (cp > 0 ? "+" : "") << cp;
+
+    return ss.str();
+}
+
+}  // namespace
+
+void UCIEngine::analyse_game(std::istream& args) {
+    // Non-UCI command: analyses a game from the last position backwards, so
+    // that the TT and the histories filled while searching a later position
+    // are already there for the positions leading to it. Nothing is cleared
+    // between the positions.
+    // Format: "analyse_game [pgn <file> | startpos | fen <fen>] [moves <m1> ...]
+    //          [depth <n> | movetime <ms>] [out <file>]"
+    // Moves may be given in UCI or in SAN notation.
+    enum { Start, Fen, Moves } mode = Start;
+
+    std::string              token, fen = StartFEN, outFile = "analysis.txt";
+    std::vector<std::string> tokens;
+    std::string              limitsStr = "depth 18";
+
+    while (args >> token)
+        if (token == "pgn")
+        {
+            std::string path;
+            args >> path;
+            if (!PGN::read_game(path, fen, tokens))
+            {
+                sync_cout << "info string Could not open PGN file " << path << sync_endl;
+                return;
+            }
+        }
+        else if (token == "startpos")
+            fen = StartFEN, mode = Start;
+        else if (token == "fen")
+            fen.clear(), mode = Fen;
+        else if (token == "moves")
+            mode = Moves;
+        else if (token == "depth" || token == "movetime")
+        {
+            std::string n;
+            args >> n;
+            limitsStr = token + " " + n;
+        }
+        else if (token == "out")
+            args >> outFile;
+        else if (mode == Fen)
+            fen += token + " ";
+        else if (mode == Moves)
+            tokens.push_back(token);
+
+    const bool chess960 = engine.get_options()["UCI_Chess960"];
+
+    // Resolve the moves once, keeping both notations of each and the FEN of
+    // every position of the game
+    auto                     states = std::make_unique<std::deque<StateInfo>>(1);
+    Position                 pos;
+    std::vector<std::string> uciMoves, sanMoves, fens;
+
+    pos.set(fen, chess960, &states->back());
+    fens.push_back(pos.fen());
+
+    for (const auto& t : tokens)
+    {
+        Move m = to_move(pos, t);
+        if (m == Move::none())
+            m = PGN::from_san(pos, t);
+
+        if (m == Move::none())
+        {
+            sync_cout << "info string Illegal move " << t << " after " << uciMoves.size()
+                      << " plies, analysing the game up to there" << sync_endl;
+            break;
+        }
+
+        uciMoves.push_back(move(m, chess960));
+        sanMoves.push_back(PGN::to_san(pos, m));
+        states->emplace_back();
+        pos.do_move(m, states->back());
+        fens.push_back(pos.fen());
+    }
+
+    const int     n = int(uciMoves.size());
+    std::ofstream out(outFile);
+
+    if (!out)
+    {
+        sync_cout << "info string Could not open " << outFile << sync_endl;
+        return;
+    }
+
+    // A book move comes without a search, so without a score, and Random Open
+    // may play another move than the best one. They are turned off while the
+    // game is analysed and turned back on afterwards.
+    OptionsMap&              options = engine.get_options();
+    std::vector<std::string> disabled;
+
+    auto set_option = [&](const std::string& name, const std::string& value) {
+        std::istringstream is("name " + name + " value " + value);
+        options.setoption(is);
+    };
+
+    for (const char* name :
+         {"Opening Policy", "Book1", "Book2", "Experience Book", "Random Open Mode"})
+        if (options.count(name) && bool(options[name]))
+        {
+            set_option(name, "false");
+            disabled.push_back(name);
+        }
+
+    // Keep only the last principal variation of each search, and silence the
+    // usual output
+    int         lastScore = AnalysisNoScore;
+    std::string lastBest;
+
+    engine.set_on_update_full([&](const auto& i) {
+        if (i.multiPV == 1)
+            lastScore = analysis_cp(i.score);
+    });
+    engine.set_on_update_no_moves([](const auto&) {});
+    engine.set_on_iter([](const auto&) {});
+    engine.set_on_bestmove([&](const auto& bm, const auto&) { lastBest = std::string(bm); });
+
+    std::vector<int>         scores(n + 1);
+    std::vector<std::string> bestMoves(n + 1);
+    const TimePoint          elapsed = now();
+
+    for (int k = n; k >= 0; --k)
+    {
+        pos.set(fens[k], chess960, &states->at(k));
+
+        // Mate or stalemate on the board, there is nothing to search
+        if (!MoveList<LEGAL>(pos).size())
+        {
+            scores[k] = pos.checkers() ? -AnalysisMateCp : 0;
+            continue;
+        }
+
+        engine.set_position(fen, {uciMoves.begin(), uciMoves.begin() + k});
+
+        std::istringstream is(limitsStr);
+        auto               limits = parse_limits(is);
+
+        lastScore = AnalysisNoScore;
+        lastBest.clear();
+        engine.go(limits);
+        engine.wait_for_search_finished();
+
+        scores[k]    = lastScore;
+        bestMoves[k] = lastBest;
+
+        sync_cout << "info string analyse_game ply " << k << "/" << n << " score "
+                  << analysis_score(lastScore) << " bestmove " << lastBest << sync_endl;
+    }
+
+    init_search_update_listeners();
+
+    for (const auto& name : disabled)
+        set_option(name, "true");
+
+    // A move loses the difference between the best score of the mover and
+    // the score after the move, both capped so that mate scores do not drown
+    // the averages.
+    int        blunders = 0, mistakes = 0, inaccuracies = 0;
+    long       totalLoss[COLOR_NB] = {};
+    int        movesBy[COLOR_NB]   = {};
+    const auto cap = [](int v) { return std::clamp(v, -AnalysisLossCap, AnalysisLossCap); };
+
+    out << "# analyse_game " << limitsStr << "\n# fen " << fen << "\n"
+        << "# move  played  eval(white)  best  best_eval(white)  loss  flag\n";
+
+    for (int k = 0; k < n; ++k)
+    {
+        pos.set(fens[k], chess960, &states->at(k));
+
+        const Color us    = pos.side_to_move();
+        const auto  white = [us](int v) {
+            return v == AnalysisNoScore ? v : us == WHITE ? v : -v;
+        };
+
+        // A position without a search result gives no loss and is not counted
+        const bool  scored   = scores[k] != AnalysisNoScore && scores[k + 1] != AnalysisNoScore;
+        const int   best     = scores[k];
+        const int   after =
+          scores[k + 1] != AnalysisNoScore ? -scores[k + 1] : AnalysisNoScore;
+        const Move  bestMove = to_move(pos, bestMoves[k]);
+        const int   loss =
+          !scored || bestMoves[k] == uciMoves[k] ? 0 : std::max(0, cap(best) - cap(after));
+        const char* flag = !scored      ? "noscore"
+                         : loss >= 300 ? "??"
+                         : loss >= 100 ? "?"
+                         : loss >= 50  ? "?!"
+                                       : "";
+
+        blunders += loss >= 300;
+        mistakes += loss >= 100 && loss < 300;
+        inaccuracies += loss >= 50 && loss < 100;
+        totalLoss[us] += loss;
+        movesBy[us] += scored;
+
+        out << pos.game_ply() / 2 + 1 << (us == WHITE ? ". " : "... ") << sanMoves[k] << "  "
+            << analysis_score(white(after)) << "  "
+            << (bestMove != Move::none() ? PGN::to_san(pos, bestMove) : std::string("-")) << "  "
+            << analysis_score(white(best)) << "  " << loss << "  " << flag << "\n";
+    }
+
+    for (Color c : {WHITE, BLACK})
+        out << "# " << (c == WHITE ? "white" : "black") << " average loss "
+            << (movesBy[c] ? totalLoss[c] / movesBy[c] : 0) << " over " << movesBy[c]
+            << " moves\n";
+
+    sync_cout << "info string analyse_game wrote " << n << " moves to " << outFile << ": "
+              << blunders << " blunders, " << mistakes << " mistakes, " << inaccuracies
+              << " inaccuracies in " << now() - elapsed << " ms" << sync_endl;
+}
+
 void UCIEngine::setoption(std::istringstream& is) {
     engine.wait_for_search_finished();
     engine.get_options().setoption(is);
@@ -920,6 +1300,7 @@ void UCIEngine::on_update_no_moves(const Engine::InfoShort& info) {
 }
 
 void UCIEngine::on_update_full(const Engine::InfoFull& info) {
+    TRACE_SCOPE("uci_info");
     std::stringstream ss;
 
     ss << "info";
@@ -953,6 +1334,7 @@ void UCIEngine::on_iter(const Engine::InfoIter& info) {
 }
 
 void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder) {
+    TRACE_SCOPE("uci_bestmove");
     sync_cout << "bestmove " << bestmove;
     if (!ponder.empty())
         std::cout << " ponder " << ponder;